@@ -1,5 +1,14 @@
 #version 460 core
 
+// without permutation defines every feature is enabled
+// the renderer only enables the features a material actually uses
+#ifndef PERMUTATION
+	#define ALBEDO_TEX
+	#define METALLIC_ROUGHNESS_TEX
+	#define NORMAL_TEX
+	#define SHADOWS
+#endif
+
 in vec3 world_normal;
 in vec3 world_position;
 in vec4 light_space_position;
@@ -145,9 +154,11 @@ vec3 blinn_phong_lighting(
 ) {
 	// lambertian diffuse
 	float diffuse_lighting = clamp( dot(directional_light_world_direction, surface.normal), 0,1 );
+#ifdef SHADOWS
 	if (directional_light_shadow_enabled) {
 		diffuse_lighting *= one_minus_shadow;
 	}
+#endif
 
 	// constant ambient lighting
 	float ambient_lighting = 0.07;
@@ -157,9 +168,11 @@ vec3 blinn_phong_lighting(
 	vec3 half_vector = normalize(directional_light_world_direction + view_direction);
 	float specular_lighting = clamp( dot(half_vector, surface.normal), 0,1 );
 	specular_lighting = pow(specular_lighting, (1.0 - surface.roughness) * 100.0);
+#ifdef SHADOWS
 	if (directional_light_shadow_enabled) {
 		specular_lighting *= one_minus_shadow;
 	}
+#endif
 
 	const float specular_strength = 0.1;
 
@@ -171,8 +184,9 @@ vec3 blinn_phong_lighting(
 }
 
 void main() {
-	bool shadow_exit_early;
 	float one_minus_shadow = 0.0;
+#ifdef SHADOWS
+	bool shadow_exit_early;
 	vec2[poisson_num_samples] poissoned_shadow_map_uvs;
 	float depth_minus_bias;
 	if (directional_light_shadow_enabled) {
@@ -180,20 +194,39 @@ void main() {
 			shadow_exit_early, one_minus_shadow, poissoned_shadow_map_uvs, depth_minus_bias
 		);
 	}
+#endif
 
 	// sample all textures at the same time
+	// textures that are not used are replaced by their neutral value
+#ifdef ALBEDO_TEX
 	vec4 t_albedo_tex = texture(albedo_tex, uv);
+#else
+	vec4 t_albedo_tex = vec4(1.0);
+#endif
+#ifdef METALLIC_ROUGHNESS_TEX
 	vec4 t_metallic_roughness_tex = texture(metallic_roughness_tex, uv);
+#else
+	vec4 t_metallic_roughness_tex = vec4(1.0);
+#endif
+#ifdef NORMAL_TEX
 	vec4 t_normal_tex = texture(normal_tex, uv);
+#endif
+#ifdef SHADOWS
 	if (directional_light_shadow_enabled && !shadow_exit_early) {
 		one_minus_shadow = poisson_sample_shadow_map(
 			poissoned_shadow_map_uvs, depth_minus_bias
 		);
 	}
+#endif
 
 	Surface surface;
 	surface.albedo = t_albedo_tex.rgb * albedo_color.rgb;
+#ifdef NORMAL_TEX
 	surface.normal = initialize_normal(t_normal_tex);
+#else
+	// a flat normal map results in the interpolated vertex normal
+	surface.normal = normalize(world_normal);
+#endif
 	surface.metallic = t_metallic_roughness_tex.b * metallic_factor;
 	surface.roughness = t_metallic_roughness_tex.g * roughness_factor;
 
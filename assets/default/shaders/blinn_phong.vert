@@ -1,4 +1,8 @@
-#version 330 core
+#version 430 core
+
+#ifndef PERMUTATION
+	#define SHADOWS
+#endif
 
 layout (location = 0) in vec3 a_position;
 layout (location = 1) in vec3 a_normal;
@@ -11,17 +15,33 @@ out vec4 light_space_position;
 out vec2 uv;
 out vec4 tangent;
 
-uniform mat4 model_matrix;
+// see OpenGLTransform
+struct Transform {
+	vec4 model_rows[3];
+	vec4 normal_columns[3];
+};
+layout (std430, binding = 0) readonly buffer Transforms {
+	Transform transforms[];
+};
+uniform uint transform_index;
 uniform mat4 view_projection_matrix;
-uniform mat3 normal_local_to_world_matrix;
 uniform mat4 light_space_matrix;
 
 void main() {
-	world_position = vec3(model_matrix * vec4(a_position, 1.0));
+	Transform transform = transforms[transform_index];
+	// row vector * transposed matrix, the rows are stored as columns
+	mat3x4 model_rows = mat3x4(transform.model_rows[0], transform.model_rows[1], transform.model_rows[2]);
+	mat3 normal_local_to_world_matrix = mat3(
+		transform.normal_columns[0].xyz, transform.normal_columns[1].xyz, transform.normal_columns[2].xyz
+	);
+
+	world_position = vec4(a_position, 1.0) * model_rows;
 	gl_Position = view_projection_matrix * vec4(world_position, 1.0);
 	uv = a_uv;
-	tangent.xyz = mat3(model_matrix) * a_tangent.xyz;
+	tangent.xyz = vec4(a_tangent.xyz, 0.0) * model_rows;
 	tangent.w = a_tangent.w;
 	world_normal = normal_local_to_world_matrix * a_normal;
+#ifdef SHADOWS
 	light_space_position = light_space_matrix * vec4(world_position, 1.0);
+#endif
 }
@@ -1,9 +1,19 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 a_position;
 
+// see OpenGLTransform
+struct Transform {
+	vec4 model_rows[3];
+	vec4 normal_columns[3];
+};
+layout (std430, binding = 0) readonly buffer Transforms {
+	Transform transforms[];
+};
+uniform uint transform_index;
 uniform mat4 view_projection_matrix;
-uniform mat4 model_matrix;
 
 void main() {
-	gl_Position = view_projection_matrix * model_matrix * vec4(a_position, 1.0);
+	Transform transform = transforms[transform_index];
+	mat3x4 model_rows = mat3x4(transform.model_rows[0], transform.model_rows[1], transform.model_rows[2]);
+	gl_Position = view_projection_matrix * vec4(vec4(a_position, 1.0) * model_rows, 1.0);
 }
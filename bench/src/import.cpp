@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <sys/resource.h>
+#endif
+
+#include <ron.h>
+
+#define ASSETS_DIR _ASSETS_DIR
+
+using namespace ron;
+
+// imports glTF files repeatedly and prints where the time is spent as json. importing only needs
+// the cpu, no OpenGL context is created.
+// the first import of every file is reported as cold, the following ones as warm. cold imports
+// also pay for the first reads of the files (unless the os cached them already) and the default
+// assets that are loaded once.
+//
+// usage: ron_import_bench [options]
+//   --asset <path>        gltf file in the asset directory, can be repeated
+//                         (default: every .gltf and .glb file in models/)
+//   --iterations <count>  imports per file, the first one is cold (default: 10)
+//   --lods                generate lods (see gltf::ImportSettings)
+//   --meshlets            build meshlets
+//   --output <path>       write the json into a file instead of stdout
+struct Options {
+	std::vector<std::string> assets = {};
+	unsigned int iterations = 10;
+	gltf::ImportSettings settings = {};
+	std::string output = {};
+};
+
+// allocations through operator new, allocations of c libraries (e.g. the decoded images of stb_image)
+// are not included
+static std::atomic<uint64_t> allocated_bytes = 0;
+static std::atomic<uint64_t> allocation_count = 0;
+
+void *operator new(const size_t size) {
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
+
+struct ImportResult {
+	gltf::ImportStats stats;
+	uint64_t allocated_bytes;
+	uint64_t allocation_count;
+};
+
+static bool parse_options(const int argc, char **argv, Options &options);
+static ImportResult measure_import(const std::string &path, const gltf::ImportSettings &settings);
+static uint64_t get_peak_rss();
+static void write_result(
+	std::ostream &out, const ImportResult &result, const double divisor, const std::string &indent
+);
+
+int main(int argc, char **argv) {
+	// the log writes to stdout, it is moved to stderr so stdout only contains the report
+	auto report_stream = std::ostream(std::cout.rdbuf());
+	std::cout.rdbuf(std::cerr.rdbuf());
+
+	Options options = {};
+	if (!parse_options(argc, argv, options)) {
+		return -1;
+	}
+
+	auto file = std::ofstream();
+	if (!options.output.empty()) {
+		file.open(options.output);
+	}
+	auto &out = options.output.empty() ? report_stream : file;
+	out << std::fixed;
+	out.precision(4);
+	out << "{\n";
+	out << "\t\"iterations\": " << options.iterations << ",\n";
+	out << "\t\"lods\": " << (options.settings.generate_lods ? "true" : "false") << ",\n";
+	out << "\t\"meshlets\": " << (options.settings.build_meshlets ? "true" : "false") << ",\n";
+	out << "\t\"assets\": [\n";
+	for (size_t i = 0; i < options.assets.size(); i++) {
+		const auto &path = options.assets[i];
+		const auto cold = measure_import(path, options.settings);
+
+		ImportResult warm = {};
+		std::vector<double> warm_totals = {};
+		for (unsigned int iteration = 1; iteration < options.iterations; iteration++) {
+			const auto result = measure_import(path, options.settings);
+			const auto &stats = result.stats;
+			auto &sum = warm.stats;
+			sum.file_read += stats.file_read;
+			sum.parse += stats.parse;
+			sum.load_buffers += stats.load_buffers;
+			sum.unpack += stats.unpack;
+			sum.tangents += stats.tangents;
+			sum.weld += stats.weld;
+			sum.lods += stats.lods;
+			sum.meshlets += stats.meshlets;
+			sum.image_decode += stats.image_decode;
+			sum.materials += stats.materials;
+			sum.total += stats.total;
+			warm.allocated_bytes += result.allocated_bytes;
+			warm.allocation_count += result.allocation_count;
+			warm_totals.push_back(stats.total);
+		}
+		std::sort(warm_totals.begin(), warm_totals.end());
+
+		out << "\t\t{\n";
+		out << "\t\t\t\"path\": \"" << path << "\",\n";
+		out << "\t\t\t\"cold\": ";
+		write_result(out, cold, 1.0, "\t\t\t");
+		if (!warm_totals.empty()) {
+			// stages are the means of the warm imports
+			out << ",\n\t\t\t\"warm\": ";
+			write_result(out, warm, static_cast<double>(warm_totals.size()), "\t\t\t");
+			out << ",\n\t\t\t\"warm_total\": {\"min\": " << warm_totals.front()
+				<< ", \"median\": " << warm_totals[warm_totals.size() / 2]
+				<< ", \"max\": " << warm_totals.back() << "}";
+		}
+		// of the process, so it includes the files imported before
+		out << ",\n\t\t\t\"peak_rss_bytes\": " << get_peak_rss() << "\n";
+		out << "\t\t}" << (i + 1 < options.assets.size() ? ",\n" : "\n");
+	}
+	out << "\t]\n";
+	out << "}\n";
+
+	if (!out) {
+		log::error("Writing the report failed (" + options.output + ")");
+		return -1;
+	}
+	if (!options.output.empty()) {
+		log::success("Report written to " + options.output);
+	}
+	return 0;
+}
+
+bool parse_options(const int argc, char **argv, Options &options) {
+	for (int i = 1; i < argc; i++) {
+		const auto option = std::string(argv[i]);
+		if (option == "--lods") {
+			options.settings.generate_lods = true;
+			continue;
+		}
+		else if (option == "--meshlets") {
+			options.settings.build_meshlets = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			log::error("Missing value for " + option);
+			return false;
+		}
+		const auto value = std::string(argv[++i]);
+		try {
+			if (option == "--asset") {
+				options.assets.push_back(value);
+			}
+			else if (option == "--iterations") {
+				options.iterations = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--output") {
+				options.output = value;
+			}
+			else {
+				log::error("Unknown option " + option);
+				return false;
+			}
+		}
+		catch (const std::exception &) {
+			log::error("Invalid value for " + option + ": " + value);
+			return false;
+		}
+	}
+
+	if (options.assets.empty()) {
+		const auto assets_directory = std::filesystem::path(ASSETS_DIR);
+		std::error_code error = {};
+		for (
+			auto it = std::filesystem::recursive_directory_iterator(assets_directory / "models", error);
+			!error && it != std::filesystem::recursive_directory_iterator();
+			it.increment(error)
+		) {
+			const auto extension = it->path().extension();
+			if (it->is_regular_file() && (extension == ".gltf" || extension == ".glb")) {
+				options.assets.push_back(it->path().lexically_relative(assets_directory).generic_string());
+			}
+		}
+		// the order of directory iteration is unspecified, reports should be comparable
+		std::sort(options.assets.begin(), options.assets.end());
+		if (options.assets.empty()) {
+			log::error("No glTF files found in " + (assets_directory / "models").string());
+			return false;
+		}
+	}
+	if (options.iterations == 0) {
+		log::error("The iteration count must not be 0");
+		return false;
+	}
+	return true;
+}
+
+ImportResult measure_import(const std::string &path, const gltf::ImportSettings &settings) {
+	ImportResult result = {};
+	const auto allocated_bytes_begin = allocated_bytes.load();
+	const auto allocation_count_begin = allocation_count.load();
+	{ // the scene is destroyed before the next import
+		const auto scene = gltf::import(path, settings, &result.stats);
+	}
+	result.allocated_bytes = allocated_bytes.load() - allocated_bytes_begin;
+	result.allocation_count = allocation_count.load() - allocation_count_begin;
+	return result;
+}
+
+uint64_t get_peak_rss() {
+#if defined(__unix__) || defined(__APPLE__)
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+	#ifdef __APPLE__
+		return static_cast<uint64_t>(usage.ru_maxrss); // bytes
+	#else
+		return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // kilobytes
+	#endif
+#else
+	return 0; // not measured on this platform
+#endif
+}
+
+void write_result(std::ostream &out, const ImportResult &result, const double divisor, const std::string &indent) {
+	const auto &stats = result.stats;
+	// milliseconds
+	out << "{\n";
+	out << indent << "\t\"file_read\": " << stats.file_read / divisor << ",\n";
+	out << indent << "\t\"parse\": " << stats.parse / divisor << ",\n";
+	out << indent << "\t\"load_buffers\": " << stats.load_buffers / divisor << ",\n";
+	out << indent << "\t\"unpack\": " << stats.unpack / divisor << ",\n";
+	out << indent << "\t\"tangents\": " << stats.tangents / divisor << ",\n";
+	out << indent << "\t\"weld\": " << stats.weld / divisor << ",\n";
+	out << indent << "\t\"lods\": " << stats.lods / divisor << ",\n";
+	out << indent << "\t\"meshlets\": " << stats.meshlets / divisor << ",\n";
+	out << indent << "\t\"image_decode\": " << stats.image_decode / divisor << ",\n";
+	out << indent << "\t\"materials\": " << stats.materials / divisor << ",\n";
+	out << indent << "\t\"total\": " << stats.total / divisor << ",\n";
+	out << indent << "\t\"allocated_bytes\": "
+		<< static_cast<uint64_t>(static_cast<double>(result.allocated_bytes) / divisor) << ",\n";
+	out << indent << "\t\"allocations\": "
+		<< static_cast<uint64_t>(static_cast<double>(result.allocation_count) / divisor) << "\n";
+	out << indent << "}";
+}
@@ -0,0 +1,318 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h> // include glfw after glad
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <ron.h>
+
+using namespace ron;
+
+// renders scenes without a window along a scripted camera path and prints the timings as json.
+// every frame is derived from its index, so runs with the same options render the same frames.
+//
+// usage: ron_bench [options]
+//   --scene <path>         gltf file in the asset directory, can be repeated
+//                          (default: the scenes of ron_example)
+//   --frames <count>       measured frames (default: 600)
+//   --warmup <count>       frames rendered before measuring (default: 60)
+//   --resolution <w>x<h>   (default: 1280x720)
+//   --context <api>        egl: surfaceless EGL (default), osmesa: OSMesa, window: hidden window
+//   --orbit <radius>       distance of the camera to the origin (default: 8)
+//   --output <path>        write the json into a file instead of stdout
+struct Options {
+	std::vector<std::string> scenes = {};
+	unsigned int frames = 600;
+	unsigned int warmup_frames = 60;
+	glm::uvec2 resolution = glm::uvec2(1280, 720);
+	std::string context = "egl";
+	float orbit_radius = 8.0f;
+	std::string output = {};
+};
+
+// timings of one measured frame, in milliseconds
+struct FrameTimes {
+	double frame_time; // wall time from the start of the frame to the start of the next one
+	double gpu_time; // GL_TIME_ELAPSED of the render call
+};
+
+static bool parse_options(const int argc, char **argv, Options &options);
+static void create_scene(Scene &scene, const Options &options, OpenGLRenderer &renderer);
+static void update_camera(PerspectiveCamera &camera, const Options &options, const unsigned int frame);
+static void write_report(
+	std::ostream &out, const Options &options, const std::vector<FrameTimes> &frame_times,
+	const FrameStatsHistory &frame_stats_history
+);
+
+int main(int argc, char **argv) {
+	// the log writes to stdout, it is moved to stderr so stdout only contains the report
+	auto report_stream = std::ostream(std::cout.rdbuf());
+	std::cout.rdbuf(std::cerr.rdbuf());
+
+	Options options = {};
+	if (!parse_options(argc, argv, options)) {
+		return -1;
+	}
+
+	GLFWwindow *window = create_headless_context(options.context, options.resolution, "Ron Benchmark");
+	if (window == NULL) {
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0); // request to disable vsync
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		log::error("Failed to initialize GLAD");
+		glfwTerminate();
+		return -1;
+	}
+
+	RON_PROFILE_THREAD("main");
+
+	{ // destroy everything that holds gpu data before the OpenGL context is destroyed (glfwTerminate)
+		auto renderer = OpenGLRenderer(options.resolution);
+		renderer.set_clear_color(glm::vec4(0.231f, 0.231f, 0.231f, 1.0f));
+		Scene scene = {};
+		create_scene(scene, options, renderer);
+
+		const auto aspect_ratio
+			= static_cast<float>(options.resolution.x) / static_cast<float>(options.resolution.y);
+		auto camera = PerspectiveCamera(40.0f, aspect_ratio, 0.1f, 1000.0f);
+
+		// the results of a query are read once all frames were rendered, so measuring never stalls
+		std::vector<GLuint> gpu_time_queries(options.frames);
+		glGenQueries(static_cast<GLsizei>(gpu_time_queries.size()), gpu_time_queries.data());
+
+		auto frame_stats_history = FrameStatsHistory(options.frames);
+		std::vector<FrameTimes> frame_times = {};
+		frame_times.reserve(options.frames);
+
+		auto frame_begin = std::chrono::steady_clock::now();
+		for (unsigned int frame = 0; frame < options.warmup_frames + options.frames; frame++) {
+			const bool measured = frame >= options.warmup_frames;
+			const auto measured_frame = frame - options.warmup_frames;
+
+			update_camera(camera, options, frame);
+			if (measured) glBeginQuery(GL_TIME_ELAPSED, gpu_time_queries[measured_frame]);
+			renderer.render(scene, camera);
+			if (measured) glEndQuery(GL_TIME_ELAPSED);
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+			RON_PROFILE_FRAME();
+
+			const auto frame_end = std::chrono::steady_clock::now();
+			if (measured) {
+				frame_times.push_back(FrameTimes(
+					std::chrono::duration<double, std::milli>(frame_end - frame_begin).count(), 0.0
+				));
+				frame_stats_history.add(renderer.get_frame_stats());
+			}
+			frame_begin = frame_end;
+		}
+
+		glFinish();
+		for (size_t i = 0; i < frame_times.size(); i++) {
+			GLuint64 gpu_time = 0;
+			glGetQueryObjectui64v(gpu_time_queries[i], GL_QUERY_RESULT, &gpu_time);
+			frame_times[i].gpu_time = static_cast<double>(gpu_time) / 1000000.0;
+		}
+		glDeleteQueries(static_cast<GLsizei>(gpu_time_queries.size()), gpu_time_queries.data());
+
+		if (options.output.empty()) {
+			write_report(report_stream, options, frame_times, frame_stats_history);
+		}
+		else {
+			auto file = std::ofstream(options.output);
+			write_report(file, options, frame_times, frame_stats_history);
+			if (!file) {
+				log::error("Writing the report failed (" + options.output + ")");
+				glfwTerminate();
+				return -1;
+			}
+			log::success("Report written to " + options.output);
+		}
+	}
+
+	glfwTerminate();
+	return 0;
+}
+
+bool parse_options(const int argc, char **argv, Options &options) {
+	for (int i = 1; i < argc; i++) {
+		const auto option = std::string(argv[i]);
+		if (i + 1 >= argc) {
+			log::error("Missing value for " + option);
+			return false;
+		}
+		const auto value = std::string(argv[++i]);
+		try {
+			if (option == "--scene") {
+				options.scenes.push_back(value);
+			}
+			else if (option == "--frames") {
+				options.frames = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--warmup") {
+				options.warmup_frames = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--resolution") {
+				const auto separator = value.find('x');
+				if (separator == std::string::npos) throw std::invalid_argument(value);
+				options.resolution = glm::uvec2(
+					std::stoul(value.substr(0, separator)), std::stoul(value.substr(separator + 1))
+				);
+			}
+			else if (option == "--context") {
+				if (value != "egl" && value != "osmesa" && value != "window") throw std::invalid_argument(value);
+				options.context = value;
+			}
+			else if (option == "--orbit") {
+				options.orbit_radius = std::stof(value);
+			}
+			else if (option == "--output") {
+				options.output = value;
+			}
+			else {
+				log::error("Unknown option " + option);
+				return false;
+			}
+		}
+		catch (const std::exception &) {
+			log::error("Invalid value for " + option + ": " + value);
+			return false;
+		}
+	}
+
+	if (options.scenes.empty()) {
+		options.scenes = {
+			"models/antique_camera/antique_camera.glb",
+			"models/shadow_test_scene/shadow_test_scene.glb",
+		};
+	}
+	if (options.frames == 0 || options.resolution.x == 0 || options.resolution.y == 0) {
+		log::error("The frame count and the resolution must not be 0");
+		return false;
+	}
+	return true;
+}
+
+void create_scene(Scene &scene, const Options &options, OpenGLRenderer &renderer) {
+	for (const auto &path : options.scenes) {
+		scene.add(gltf::import(path));
+	}
+
+	DirectionalLight directional_light = {};
+	directional_light.use_custom_shadow_target_world_position = true;
+	directional_light.custom_shadow_target_world_position = glm::vec3(0.0f);
+	directional_light.world_direction = glm::normalize(glm::vec3(4.1f, 5.9f, -1.0f));
+	directional_light.shadow.enabled = true;
+	directional_light.shadow.map_size = glm::uvec2(1024);
+	directional_light.shadow.bias = 0.01f;
+	directional_light.shadow.far = 100.0f;
+	directional_light.shadow.frustum_size = 10.0f;
+	scene.set_directional_light(directional_light);
+
+	renderer.preload(scene);
+	// compiling in the background would make the first measured frames use the error shader program
+	renderer.wait_for_shader_programs();
+}
+
+void update_camera(PerspectiveCamera &camera, const Options &options, const unsigned int frame) {
+	// one orbit around the origin per 600 frames, bobbing up and down and moving closer and back,
+	// so lods switch and nodes leave the frustum
+	const auto t = glm::radians(static_cast<float>(frame) / 600.0f * 360.0f);
+	const auto distance = options.orbit_radius * (0.75f + 0.25f * std::cos(2.0f * t));
+	const auto position = glm::vec3(
+		distance * std::cos(t), options.orbit_radius * (0.35f + 0.15f * std::sin(3.0f * t)), distance * std::sin(t)
+	);
+	camera.set_model_matrix(glm::inverse(glm::lookAt(position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f))));
+}
+
+static void write_summary(std::ostream &out, const FrameStatsHistory::Summary &summary) {
+	out << "{\"min\": " << summary.min << ", \"mean\": " << summary.mean << ", \"median\": " << summary.median
+		<< ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << "}";
+}
+
+static void write_pass_stats(
+	std::ostream &out, const FrameStatsHistory &history, FrameStats::Pass FrameStats::*pass
+) {
+	const auto write_counter = [&](const char *name, const auto &get_value, const bool last = false) {
+		out << "\t\t\t\"" << name << "\": ";
+		write_summary(out, history.summarize(
+			[&](const FrameStats &frame_stats) { return get_value(frame_stats.*pass); }
+		));
+		out << (last ? "\n" : ",\n");
+	};
+	out << "{\n";
+	write_counter("draw_calls", [](const FrameStats::Pass &p) { return p.draw_calls; });
+	write_counter("instances", [](const FrameStats::Pass &p) { return p.instances; });
+	write_counter("triangles", [](const FrameStats::Pass &p) { return p.triangles; });
+	write_counter("drawn_nodes", [](const FrameStats::Pass &p) { return p.drawn_nodes; });
+	write_counter("culled_nodes", [](const FrameStats::Pass &p) { return p.culled_nodes; }, true);
+	out << "\t\t}";
+}
+
+void write_report(
+	std::ostream &out, const Options &options, const std::vector<FrameTimes> &frame_times,
+	const FrameStatsHistory &frame_stats_history
+) {
+	std::vector<double> frame_time_values = {};
+	std::vector<double> gpu_time_values = {};
+	for (const auto &times : frame_times) {
+		frame_time_values.push_back(times.frame_time);
+		gpu_time_values.push_back(times.gpu_time);
+	}
+	const auto get_string = [](const GLenum name) {
+		const auto value = reinterpret_cast<const char *>(glGetString(name));
+		return std::string(value ? value : "");
+	};
+	const auto write_counter = [&](const char *name, const auto &get_value, const bool last = false) {
+		out << "\t\t\"" << name << "\": ";
+		write_summary(out, frame_stats_history.summarize(get_value));
+		out << (last ? "\n" : ",\n");
+	};
+
+	out << std::fixed;
+	out.precision(4);
+	out << "{\n";
+	out << "\t\"renderer\": \"" << get_string(GL_RENDERER) << "\",\n";
+	out << "\t\"version\": \"" << get_string(GL_VERSION) << "\",\n";
+	out << "\t\"context\": \"" << options.context << "\",\n";
+	out << "\t\"resolution\": [" << options.resolution.x << ", " << options.resolution.y << "],\n";
+	out << "\t\"frames\": " << options.frames << ",\n";
+	out << "\t\"warmup_frames\": " << options.warmup_frames << ",\n";
+	out << "\t\"scenes\": [";
+	for (size_t i = 0; i < options.scenes.size(); i++) {
+		out << (i == 0 ? "\"" : ", \"") << options.scenes[i] << "\"";
+	}
+	out << "],\n";
+	// milliseconds. cpu_time is spent in OpenGLRenderer::render, gpu_time executing what it submitted
+	out << "\t\"frame_time\": ";
+	write_summary(out, FrameStatsHistory::summarize_values(frame_time_values));
+	out << ",\n\t\"cpu_time\": ";
+	write_summary(out, frame_stats_history.summarize([](const FrameStats &s) { return s.cpu_time; }));
+	out << ",\n\t\"gpu_time\": ";
+	write_summary(out, FrameStatsHistory::summarize_values(gpu_time_values));
+	out << ",\n\t\"frame_stats\": {\n";
+	out << "\t\t\"shadow_pass\": ";
+	write_pass_stats(out, frame_stats_history, &FrameStats::shadow_pass);
+	out << ",\n\t\t\"main_pass\": ";
+	write_pass_stats(out, frame_stats_history, &FrameStats::main_pass);
+	out << ",\n";
+	write_counter("shadow_map_renders", [](const FrameStats &s) { return s.shadow_map_renders; });
+	write_counter("program_binds", [](const FrameStats &s) { return s.program_binds; });
+	write_counter("vertex_array_binds", [](const FrameStats &s) { return s.vertex_array_binds; });
+	write_counter("texture_binds", [](const FrameStats &s) { return s.texture_binds; });
+	write_counter("uniform_uploads", [](const FrameStats &s) { return s.uniform_uploads; });
+	write_counter("uploaded_bytes", [](const FrameStats &s) { return s.uploaded_bytes; }, true);
+	out << "\t}\n";
+	out << "}\n";
+}
@@ -0,0 +1,298 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <ron.h>
+
+using namespace ron;
+
+// measures the cpu time of the renderer on the null OpenGL backend (see opengl_backend.h), so neither
+// a gpu nor a driver is needed and driver noise does not hide regressions of the renderer itself.
+// one more iteration of every benchmark runs on the recording backend to count the OpenGL calls.
+//
+// usage: ron_micro_bench [options]
+//   --iterations <count>  measured iterations of every benchmark (default: 20)
+//   --nodes <count>       mesh nodes of the draw loop benchmark (default: 100000)
+//   --materials <count>   materials of the uniforms benchmark, one node each (default: 10000)
+//   --geometries <count>  geometries of the preload benchmark (default: 2000)
+//   --output <path>       write the json into a file instead of stdout
+struct Options {
+	unsigned int iterations = 20;
+	unsigned int nodes = 100000;
+	unsigned int materials = 10000;
+	unsigned int geometries = 2000;
+	std::string output = {};
+};
+
+struct Benchmark {
+	std::string name;
+	std::function<void()> setup; // not measured
+	std::function<void()> run;
+};
+
+struct BenchmarkResult {
+	std::string name;
+	FrameStatsHistory::Summary time; // milliseconds
+	std::map<std::string, size_t> calls; // of one iteration
+};
+
+static bool parse_options(const int argc, char **argv, Options &options);
+static std::shared_ptr<Geometry> create_cube();
+static std::shared_ptr<Texture> create_texture(const unsigned char value);
+static BenchmarkResult run_benchmark(const Benchmark &benchmark, const unsigned int iterations);
+static void write_report(std::ostream &out, const Options &options, const std::vector<BenchmarkResult> &results);
+
+int main(int argc, char **argv) {
+	// the log writes to stdout, it is moved to stderr so stdout only contains the report
+	auto report_stream = std::ostream(std::cout.rdbuf());
+	std::cout.rdbuf(std::cerr.rdbuf());
+
+	Options options = {};
+	if (!parse_options(argc, argv, options)) {
+		return -1;
+	}
+	if (!opengl_load_null_backend()) {
+		log::error("Failed to load the null OpenGL backend");
+		return -1;
+	}
+
+	std::vector<BenchmarkResult> results = {};
+	{ // the renderer is destroyed before the report is written, like it would be before the context
+		auto renderer = OpenGLRenderer(1920, 1080);
+		auto camera = PerspectiveCamera(40.0f, 1920.0f / 1080.0f, 0.1f, 10000.0f);
+		const auto cube = create_cube();
+
+		// uploads geometries and textures that the renderer has not seen yet
+		Scene preload_scene = {};
+		results.push_back(run_benchmark(Benchmark(
+			"preload",
+			[&]() {
+				preload_scene = {};
+				for (unsigned int i = 0; i < options.geometries; i++) {
+					const auto material = std::make_shared<Material>(*preload_scene.default_material);
+					if (i % 10 == 0) {
+						material->uniforms["albedo_tex"] = make_uniform(create_texture(static_cast<unsigned char>(i)));
+					}
+					auto mesh = std::make_shared<Mesh>();
+					// not copies of cube, they would share its renderer handle
+					const auto geometry = create_cube();
+					mesh->sections.push_back(MeshSection(
+						geometry, material, {}, compute_bounding_sphere(geometry->positions)
+					));
+					preload_scene.add(std::make_shared<MeshNode>(mesh, glm::identity<glm::mat4>()));
+				}
+			},
+			[&]() { renderer.preload(preload_scene); }
+		), options.iterations));
+		preload_scene = {};
+
+		// nodes that share a material and geometry, mostly measures culling, sorting and the draw loop
+		Scene draw_loop_scene = {};
+		const auto grid_size = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(options.nodes))));
+		auto shared_mesh = std::make_shared<Mesh>();
+		shared_mesh->sections.push_back(MeshSection(cube, nullptr, {}, compute_bounding_sphere(cube->positions)));
+		for (unsigned int i = 0; i < options.nodes; i++) {
+			const auto position = glm::vec3(
+				static_cast<float>(i % grid_size) * 2.0f, 0.0f, static_cast<float>(i / grid_size) * 2.0f
+			);
+			draw_loop_scene.add(std::make_shared<MeshNode>(
+				shared_mesh, glm::translate(glm::identity<glm::mat4>(), position)
+			));
+		}
+		// looks at the whole grid, so no node is culled
+		const auto grid_center = glm::vec3(static_cast<float>(grid_size), 0.0f, static_cast<float>(grid_size));
+		camera.set_model_matrix(glm::inverse(glm::lookAt(
+			grid_center + glm::vec3(0.0f, 4.0f * static_cast<float>(grid_size), 0.1f), grid_center,
+			glm::vec3(0.0f, 1.0f, 0.0f)
+		)));
+		renderer.preload(draw_loop_scene);
+		renderer.wait_for_shader_programs();
+		results.push_back(run_benchmark(Benchmark(
+			"draw_loop", []() {}, [&]() { renderer.render(draw_loop_scene, camera); }
+		), options.iterations));
+		draw_loop_scene = {};
+
+		// a material per node, so the uniforms of every material are set
+		Scene uniforms_scene = {};
+		const auto uniforms_grid_size
+			= static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(options.materials))));
+		for (unsigned int i = 0; i < options.materials; i++) {
+			const auto material = std::make_shared<Material>(*uniforms_scene.default_material);
+			material->uniforms["albedo_color"] = make_uniform(glm::vec4(
+				static_cast<float>(i) / static_cast<float>(options.materials), 0.5f, 0.5f, 1.0f
+			));
+			auto mesh = std::make_shared<Mesh>();
+			mesh->sections.push_back(MeshSection(cube, material, {}, compute_bounding_sphere(cube->positions)));
+			const auto position = glm::vec3(
+				static_cast<float>(i % uniforms_grid_size) * 2.0f, 0.0f,
+				static_cast<float>(i / uniforms_grid_size) * 2.0f
+			);
+			uniforms_scene.add(std::make_shared<MeshNode>(
+				mesh, glm::translate(glm::identity<glm::mat4>(), position)
+			));
+		}
+		renderer.preload(uniforms_scene);
+		renderer.wait_for_shader_programs();
+		results.push_back(run_benchmark(Benchmark(
+			"uniforms", []() {}, [&]() { renderer.render(uniforms_scene, camera); }
+		), options.iterations));
+	}
+
+	if (options.output.empty()) {
+		write_report(report_stream, options, results);
+	}
+	else {
+		auto file = std::ofstream(options.output);
+		write_report(file, options, results);
+		if (!file) {
+			log::error("Writing the report failed (" + options.output + ")");
+			return -1;
+		}
+		log::success("Report written to " + options.output);
+	}
+	return 0;
+}
+
+bool parse_options(const int argc, char **argv, Options &options) {
+	for (int i = 1; i < argc; i++) {
+		const auto option = std::string(argv[i]);
+		if (i + 1 >= argc) {
+			log::error("Missing value for " + option);
+			return false;
+		}
+		const auto value = std::string(argv[++i]);
+		try {
+			if (option == "--iterations") {
+				options.iterations = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--nodes") {
+				options.nodes = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--materials") {
+				options.materials = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--geometries") {
+				options.geometries = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--output") {
+				options.output = value;
+			}
+			else {
+				log::error("Unknown option " + option);
+				return false;
+			}
+		}
+		catch (const std::exception &) {
+			log::error("Invalid value for " + option + ": " + value);
+			return false;
+		}
+	}
+	if (options.iterations == 0) {
+		log::error("The iteration count must not be 0");
+		return false;
+	}
+	return true;
+}
+
+std::shared_ptr<Geometry> create_cube() {
+	auto geometry = std::make_shared<Geometry>();
+	for (int axis = 0; axis < 3; axis++) {
+		for (const float side : { -1.0f, 1.0f }) {
+			auto normal = glm::vec3(0.0f);
+			normal[axis] = side;
+			const auto u = glm::vec3(normal.y != 0.0f, normal.z != 0.0f, normal.x != 0.0f);
+			const auto v = glm::cross(normal, u);
+			const auto first_vertex = static_cast<uint32_t>(geometry->positions.size());
+			for (const auto corner : { glm::vec2(-1, -1), glm::vec2(1, -1), glm::vec2(1, 1), glm::vec2(-1, 1) }) {
+				geometry->positions.push_back(0.5f * (normal + corner.x * u + corner.y * v));
+				geometry->normals.push_back(normal);
+				geometry->uvs.push_back(0.5f * corner + 0.5f);
+			}
+			for (const uint32_t index : { 0u, 1u, 2u, 0u, 2u, 3u }) {
+				geometry->indices.push_back(first_vertex + index);
+			}
+		}
+	}
+	geometry->tangents = generate_tangents(*geometry);
+	return geometry;
+}
+
+std::shared_ptr<Texture> create_texture(const unsigned char value) {
+	// textures free their image data like stb_image does
+	static const int size = 64;
+	Texture::ImageData image_data = {};
+	image_data.width = size;
+	image_data.height = size;
+	image_data.n_channels = 4;
+	image_data.data_ptr = static_cast<unsigned char *>(std::malloc(size * size * 4));
+	std::memset(image_data.data_ptr, value, size * size * 4);
+	return std::make_shared<Texture>(image_data, "micro bench texture");
+}
+
+BenchmarkResult run_benchmark(const Benchmark &benchmark, const unsigned int iterations) {
+	BenchmarkResult result = {};
+	result.name = benchmark.name;
+
+	std::vector<double> times = {};
+	for (unsigned int i = 0; i < iterations; i++) {
+		benchmark.setup();
+		const auto begin = std::chrono::steady_clock::now();
+		benchmark.run();
+		times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+	}
+	result.time = FrameStatsHistory::summarize_values(times);
+
+	// recording is slower, so it is not part of the measured iterations
+	OpenGLRecording recording = {};
+	opengl_load_recording_backend(recording);
+	benchmark.setup();
+	benchmark.run();
+	opengl_load_null_backend();
+	for (const auto &call : recording.calls) {
+		result.calls[call.name]++;
+	}
+	return result;
+}
+
+void write_report(std::ostream &out, const Options &options, const std::vector<BenchmarkResult> &results) {
+	out << std::fixed;
+	out.precision(4);
+	out << "{\n";
+	out << "\t\"iterations\": " << options.iterations << ",\n";
+	out << "\t\"nodes\": " << options.nodes << ",\n";
+	out << "\t\"materials\": " << options.materials << ",\n";
+	out << "\t\"geometries\": " << options.geometries << ",\n";
+	out << "\t\"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto &result = results[i];
+		out << "\t\t{\n";
+		out << "\t\t\t\"name\": \"" << result.name << "\",\n";
+		// milliseconds
+		out << "\t\t\t\"time\": {\"min\": " << result.time.min << ", \"mean\": " << result.time.mean
+			<< ", \"median\": " << result.time.median << ", \"p95\": " << result.time.p95
+			<< ", \"max\": " << result.time.max << "},\n";
+		size_t call_count = 0;
+		for (const auto &[name, count] : result.calls) { call_count += count; }
+		out << "\t\t\t\"opengl_calls\": " << call_count << ",\n";
+		out << "\t\t\t\"opengl_calls_by_function\": {";
+		bool first = true;
+		for (const auto &[name, count] : result.calls) {
+			out << (first ? "" : ", ") << "\"" << name << "\": " << count;
+			first = false;
+		}
+		out << "}\n";
+		out << "\t\t}" << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "\t]\n";
+	out << "}\n";
+}
@@ -55,6 +55,8 @@ int main() {
 
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
+	RON_PROFILE_THREAD("main");
+
 	{ // this scope ensures that "state" is destroyed before the opengl context is destroyed (glfwTerminate)
 		State state {};
 		glfwSetWindowUserPointer(window, static_cast<void *>(&state));
@@ -98,6 +100,7 @@ int main() {
 
 			glfwSwapBuffers(window);
 			glfwPollEvents();
+			RON_PROFILE_FRAME();
 		}
 	}
 
@@ -136,9 +139,13 @@ void create_scene(State& state) {
 	state.scene.set_directional_light(directional_light);
 
 	state.renderer->preload(state.scene);
+	// shader programs compile in parallel, wait for them so the first frame is complete
+	state.renderer->wait_for_shader_programs();
 }
 
 void initialize(GLFWwindow* window, State& state) {
+	// shaders and textures are reloaded when their files change (see process)
+	assets::watch();
 	state.renderer = std::make_unique<ron::OpenGLRenderer>(initial_resolution);
 
 	state.renderer->set_clear_color(glm::vec4(0.231f, 0.231f, 0.231f, 1.0f));
@@ -161,9 +168,20 @@ void process(GLFWwindow* window, State& state) {
 		glfwSetWindowShouldClose(window, true);
 		return;
 	}
+	// the zones of the last frames, open it in chrome://tracing or ui.perfetto.dev
+	// (only recorded when building with RON_PROFILING)
+	static bool trace_key_pressed = false;
+	if (glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS && !trace_key_pressed) {
+		if (profiler::write_chrome_trace("ron_trace.json")) {
+			log::success("Trace written to ron_trace.json");
+		}
+	}
+	trace_key_pressed = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
 	state.camera_controls->update(*window, *state.camera);
 
-	if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS) {
+	// with a watcher only files that changed are read, cheap enough to do every frame.
+	// without one every file is checked, so only reload on F5
+	if (assets::is_watching() || glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS) {
 		assets::reload_shader_programs();
 		assets::reload_textures();
 	}
@@ -1,14 +1,24 @@
 #include "../src/assets.h"
+#include "../src/batch_renderer.h"
 #include "../src/camera_viewport_controls.h"
+#include "../src/frame_stats.h"
 #include "../src/gltf.h"
+#include "../src/headless_context.h"
 #include "../src/i_camera.h"
 #include "../src/i_spatial.h"
 #include "../src/log.h"
 #include "../src/material.h"
 #include "../src/meshes.h"
+#include "../src/opengl_backend.h"
 #include "../src/opengl_rendering.h"
 #include "../src/perspective_camera.h"
+#include "../src/profiler.h"
+#include "../src/residency.h"
 #include "../src/scene.h"
+#include "../src/scene_journal.h"
+#include "../src/scene_snapshot.h"
 #include "../src/shader_program.h"
 #include "../src/texture.h"
+#include "../src/thread_pool.h"
+#include "../src/transform_hierarchy.h"
 #include "../src/uniforms.h"
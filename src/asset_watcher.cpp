@@ -0,0 +1,99 @@
+#include "asset_watcher.h"
+
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <unistd.h>
+	#include <cerrno>
+	#include <cstring>
+#endif
+
+#include "log.h"
+
+using namespace ron;
+
+#ifdef __linux__
+
+AssetWatcher::AssetWatcher(const std::string &root_directory) : m_root_directory(root_directory) {
+	m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify_fd == -1) {
+		log::warn(
+			std::string("Could not watch asset files, changes have to be polled: ")
+			+ std::strerror(errno)
+		);
+	}
+}
+
+AssetWatcher::~AssetWatcher() {
+	// closing the descriptor also removes all watches
+	if (m_inotify_fd != -1) close(m_inotify_fd);
+}
+
+void AssetWatcher::watch(const std::string &asset_path) {
+	if (m_inotify_fd == -1) return;
+
+	const auto separator = asset_path.find_last_of('/');
+	const auto directory = separator == std::string::npos ? "" : asset_path.substr(0, separator + 1);
+	if (m_directories.contains(directory)) return;
+
+	// editors either write the file directly or write a temporary file and rename it
+	const auto watch_descriptor = inotify_add_watch(
+		m_inotify_fd, (m_root_directory + directory).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO
+	);
+	if (watch_descriptor == -1) {
+		log::warn(
+			"Could not watch asset directory \"" + m_root_directory + directory + "\": "
+			+ std::strerror(errno)
+		);
+		return;
+	}
+	m_watched_directories[watch_descriptor] = directory;
+	m_directories.insert(directory);
+}
+
+bool AssetWatcher::is_watching() const { return m_inotify_fd != -1; }
+
+bool AssetWatcher::poll(std::vector<std::string> &changed_asset_paths) {
+	if (m_inotify_fd == -1) return false;
+
+	bool complete = true;
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		const auto length = read(m_inotify_fd, buffer, sizeof(buffer));
+		// the descriptor is non blocking, reading fails with EAGAIN when there are no more events
+		if (length <= 0) break;
+
+		for (ssize_t offset = 0; offset < length;) {
+			const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				complete = false;
+				continue;
+			}
+			const auto directory = m_watched_directories.find(event->wd);
+			if (directory == m_watched_directories.end()) continue;
+
+			if (event->mask & IN_IGNORED) {
+				// the directory was removed, it is watched again when an asset in it is loaded
+				m_directories.erase(directory->second);
+				m_watched_directories.erase(directory);
+				complete = false;
+				continue;
+			}
+			if (event->len > 0) {
+				changed_asset_paths.push_back(directory->second + event->name);
+			}
+		}
+	}
+	return complete;
+}
+
+#else
+
+AssetWatcher::AssetWatcher(const std::string &root_directory) : m_root_directory(root_directory) {}
+AssetWatcher::~AssetWatcher() {}
+void AssetWatcher::watch(const std::string &) {}
+bool AssetWatcher::poll(std::vector<std::string> &) { return false; }
+bool AssetWatcher::is_watching() const { return false; }
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ron {
+
+// watches the directories of asset files and reports the files that were written to or replaced
+// uses inotify on linux, on other platforms nothing is reported and poll always returns false
+class AssetWatcher {
+public:
+	// root_directory is prepended to all asset paths, it has to end with a slash
+	AssetWatcher(const std::string &root_directory);
+	~AssetWatcher();
+	// forbid copying
+	AssetWatcher(const AssetWatcher&) = delete;
+	AssetWatcher &operator=(const AssetWatcher&) = delete;
+
+	// starts watching the directory of the asset, does nothing if it is already watched
+	void watch(const std::string &asset_path);
+	// appends the asset paths of files that changed since the last call, they may contain duplicates
+	// and files that were never passed to watch. returns false if changes may have been missed,
+	// the caller then has to check all of its files
+	bool poll(std::vector<std::string> &changed_asset_paths);
+	// false if changes are not reported on this platform or watching could not be set up,
+	// poll then always returns false
+	bool is_watching() const;
+private:
+	std::string m_root_directory;
+	int m_inotify_fd = -1;
+	// watch descriptor -> asset path of the directory, ending with a slash
+	std::unordered_map<int, std::string> m_watched_directories = {};
+	std::unordered_set<std::string> m_directories = {};
+};
+
+} // ron
@@ -6,14 +6,41 @@
 #include <vector>
 #include <map>
 #include <filesystem>
+#include <future>
+#include <mutex>
 #include <cassert>
 
+#include "asset_watcher.h"
 #include "log.h"
 
 #define ASSETS_DIR _ASSETS_DIR
 
 using namespace ron;
 
+// assets may be loaded by the application while a render thread loads shader program variants or
+// reloads assets (see OpenGLRenderThread). recursive, loading a variant loads a shader program
+static std::recursive_mutex assets_mutex;
+
+// created by watch, so applications that never reload do not watch any files
+static std::unique_ptr<AssetWatcher> asset_watcher = nullptr;
+// changes reported by the asset watcher, that reload_shader_programs / reload_textures did not handle yet
+static auto changed_shader_asset_paths = std::set<std::string>();
+static auto changed_texture_asset_paths = std::set<std::string>();
+// set if the watcher may have missed changes, the next reload checks every file
+static bool reload_all_shader_programs = false;
+static bool reload_all_textures = false;
+
+static void poll_asset_watcher() {
+	static auto changed_asset_paths = std::vector<std::string>();
+	changed_asset_paths.clear();
+	if (!asset_watcher || !asset_watcher->poll(changed_asset_paths)) {
+		reload_all_shader_programs = true;
+		reload_all_textures = true;
+	}
+	changed_shader_asset_paths.insert(changed_asset_paths.begin(), changed_asset_paths.end());
+	changed_texture_asset_paths.insert(changed_asset_paths.begin(), changed_asset_paths.end());
+}
+
 std::string assets::read_text_file(const std::string& asset_path) {
 	const auto complete_path = ASSETS_DIR + asset_path;
 
@@ -39,51 +66,135 @@ std::string assets::read_text_file(const std::string& asset_path) {
 	return file_content;
 }
 
+static std::string insert_defines(const std::string &source, const std::set<std::string> &defines) {
+	if (defines.empty()) {
+		return source;
+	}
+	std::string define_lines;
+	for (const auto &define : defines) { define_lines += "#define " + define + "\n"; }
+
+	// defines have to come after the #version directive
+	const auto version = source.find("#version");
+	const auto line_end = version == std::string::npos ? version : source.find('\n', version);
+	if (line_end == std::string::npos) {
+		return define_lines + source;
+	}
+	// reset the line number, so compiler errors point to the right line of the file
+	return source.substr(0, line_end + 1) + define_lines + "#line 2\n" + source.substr(line_end + 1);
+}
+
+struct ShaderProgramIdentifier {
+	std::string vertex_shader_asset_path;
+	std::string fragment_shader_asset_path;
+	std::set<std::string> defines;
+
+	auto operator<=>(const ShaderProgramIdentifier&) const = default;
+};
+
 // keep track of all loaded shaders
-static auto loaded_shaders = std::map<
-	std::pair<std::string, std::string>,
-	std::weak_ptr<ShaderProgram>
+static auto loaded_shaders = std::map<ShaderProgramIdentifier, std::weak_ptr<ShaderProgram>>();
+// used to find out how a shader program was loaded, when a variant of it is requested
+// keyed by owner, a shader program allocated at the address of a destroyed one is a different key
+static auto loaded_shader_identifiers = std::map<
+	std::weak_ptr<ShaderProgram>, ShaderProgramIdentifier, std::owner_less<>
 >();
 
+static void update_shader_program(ShaderProgram &shader_program, const ShaderProgramIdentifier &id) {
+	// the update will only happen, if the content changed
+	shader_program.update(
+		insert_defines(assets::read_text_file(id.vertex_shader_asset_path), id.defines),
+		insert_defines(assets::read_text_file(id.fragment_shader_asset_path), id.defines)
+	);
+}
+
 std::shared_ptr<ShaderProgram> assets::load_shader_program(
-	const std::string& vertex_shader_asset_path, const std::string& fragment_shader_asset_path
+	const std::string& vertex_shader_asset_path, const std::string& fragment_shader_asset_path,
+	const std::set<std::string> &defines
 ) {
-	const auto asset_path_pair = std::make_pair(vertex_shader_asset_path, fragment_shader_asset_path);
+	std::lock_guard lock(assets_mutex);
+	const auto identifier = ShaderProgramIdentifier(
+		vertex_shader_asset_path, fragment_shader_asset_path, defines
+	);
 
 	// if shader is already loaded, update and return it
-	if (loaded_shaders.contains(asset_path_pair)) {
-		const auto wp_existing = loaded_shaders[asset_path_pair];
+	if (loaded_shaders.contains(identifier)) {
+		const auto wp_existing = loaded_shaders[identifier];
 		if (const auto sp_existing = wp_existing.lock()) {
-			// the update will only happen, if the content changed
-			sp_existing->update(
-				assets::read_text_file(vertex_shader_asset_path),
-				assets::read_text_file(fragment_shader_asset_path)
-			);
+			update_shader_program(*sp_existing, identifier);
 			return sp_existing;
 		}
 	}
 
+	auto name = vertex_shader_asset_path + ", " + fragment_shader_asset_path;
+	for (const auto &define : defines) { name += " #" + define; }
+
 	const auto shader_program = std::make_shared<ShaderProgram>(
-		assets::read_text_file(vertex_shader_asset_path),
-		assets::read_text_file(fragment_shader_asset_path),
-		vertex_shader_asset_path + ", " + fragment_shader_asset_path
+		insert_defines(assets::read_text_file(vertex_shader_asset_path), defines),
+		insert_defines(assets::read_text_file(fragment_shader_asset_path), defines),
+		name
 	);
 
-	loaded_shaders[asset_path_pair] = shader_program;
+	// forget destroyed shader programs, so the maps do not grow with every load
+	std::erase_if(loaded_shaders, [](const auto &entry) { return entry.second.expired(); });
+	std::erase_if(loaded_shader_identifiers, [](const auto &entry) { return entry.first.expired(); });
+	loaded_shaders[identifier] = shader_program;
+	loaded_shader_identifiers[shader_program] = identifier;
+	if (asset_watcher) {
+		asset_watcher->watch(vertex_shader_asset_path);
+		asset_watcher->watch(fragment_shader_asset_path);
+	}
 
 	return shader_program;
 }
 
+std::shared_ptr<ShaderProgram> assets::load_shader_program_variant(
+	const std::shared_ptr<ShaderProgram> &shader_program, const std::set<std::string> &defines
+) {
+	std::lock_guard lock(assets_mutex);
+	const auto identifier = loaded_shader_identifiers.find(shader_program);
+	if (identifier == loaded_shader_identifiers.end()) {
+		return shader_program;
+	}
+	if (identifier->second.defines == defines) {
+		return shader_program;
+	}
+
+	const auto variant_identifier = ShaderProgramIdentifier(
+		identifier->second.vertex_shader_asset_path,
+		identifier->second.fragment_shader_asset_path,
+		defines
+	);
+	// don't use load_shader_program for existing variants, it would read the files again
+	if (const auto existing = loaded_shaders[variant_identifier].lock()) {
+		return existing;
+	}
+	return load_shader_program(
+		variant_identifier.vertex_shader_asset_path, variant_identifier.fragment_shader_asset_path,
+		defines
+	);
+}
+
 void assets::reload_shader_programs() {
-	for (const auto &[asset_paths, shader_program] : loaded_shaders) {
+	std::lock_guard lock(assets_mutex);
+	poll_asset_watcher();
+	if (!reload_all_shader_programs && changed_shader_asset_paths.empty()) {
+		return;
+	}
+
+	for (const auto &[identifier, shader_program] : loaded_shaders) {
+		if (!reload_all_shader_programs
+			&& !changed_shader_asset_paths.contains(identifier.vertex_shader_asset_path)
+			&& !changed_shader_asset_paths.contains(identifier.fragment_shader_asset_path)
+		) {
+			continue;
+		}
 		if (const auto sp_shader_program = shader_program.lock()) {
-			// the update will only happen, if the content changed
-			sp_shader_program->update(
-				assets::read_text_file(asset_paths.first),
-				assets::read_text_file(asset_paths.second)
-			);
+			update_shader_program(*sp_shader_program, identifier);
 		}
 	}
+
+	reload_all_shader_programs = false;
+	changed_shader_asset_paths.clear();
 }
 
 struct TextureWithLastUpdateTime {
@@ -116,6 +227,7 @@ std::shared_ptr<Texture> assets::load_texture(
 	const Texture::MetaData &meta_data,
 	const Texture::SampleData &sample_data
 ) {
+	std::lock_guard lock(assets_mutex);
 	const auto complete_path = ASSETS_DIR + asset_path;
 
 	const auto texture_identifier = TextureIdentifier(asset_path, meta_data, sample_data);
@@ -146,26 +258,109 @@ std::shared_ptr<Texture> assets::load_texture(
 	const auto texture = std::make_shared<Texture>(
 		Texture::image_data_from_file(complete_path), asset_path, meta_data, sample_data
 	);
+	// released image data can be decoded from the file again
+	texture->image_data_source = [complete_path]() { return Texture::image_data_from_file(complete_path); };
 
 	loaded_textures[texture_identifier] = TextureWithLastUpdateTime(
 		texture,
 		std::filesystem::last_write_time(complete_path)
 	);
+	if (asset_watcher) asset_watcher->watch(asset_path);
 
 	return texture;
 }
 
+void assets::watch() {
+	std::lock_guard lock(assets_mutex);
+	if (asset_watcher) return;
+	asset_watcher = std::make_unique<AssetWatcher>(ASSETS_DIR);
+	for (const auto &[identifier, shader_program] : loaded_shaders) {
+		asset_watcher->watch(identifier.vertex_shader_asset_path);
+		asset_watcher->watch(identifier.fragment_shader_asset_path);
+	}
+	for (const auto &[identifier, texture] : loaded_textures) {
+		asset_watcher->watch(identifier.asset_path);
+	}
+	// changes before the watches were added were not reported
+	reload_all_shader_programs = true;
+	reload_all_textures = true;
+}
+
+bool assets::is_watching() {
+	std::lock_guard lock(assets_mutex);
+	return asset_watcher && asset_watcher->is_watching();
+}
+
+// decoding of changed textures, that runs on worker threads
+struct TextureReload {
+	std::future<Texture::ImageData> image_data;
+	std::filesystem::file_time_type last_write_time;
+};
+static auto pending_texture_reloads = std::map<TextureIdentifier, TextureReload>();
+
+// swap in the image data of all finished reloads, this happens on the thread that calls
+// reload_textures, so the renderer never sees a texture that is only partially updated
+static void publish_finished_texture_reloads() {
+	for (auto it = pending_texture_reloads.begin(); it != pending_texture_reloads.end();) {
+		auto &[texture_identifier, reload] = *it;
+		if (reload.image_data.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++it;
+			continue;
+		}
+
+		auto image_data = reload.image_data.get();
+		const auto loaded = loaded_textures.find(texture_identifier);
+		const auto sp_texture = loaded != loaded_textures.end() ? loaded->second.texture.lock() : nullptr;
+		if (sp_texture && image_data.data_ptr) {
+			sp_texture->update(image_data);
+			loaded->second.last_update_time = reload.last_write_time;
+		}
+		else if (image_data.data_ptr) {
+			// the texture was destroyed in the meantime
+			Texture::free_image_data(image_data);
+		}
+		it = pending_texture_reloads.erase(it);
+	}
+}
+
 void assets::reload_textures() {
+	std::lock_guard lock(assets_mutex);
+	publish_finished_texture_reloads();
+
+	poll_asset_watcher();
+	if (!reload_all_textures && changed_texture_asset_paths.empty()) {
+		return;
+	}
+
+	// files that change while they are still being decoded are decoded again afterwards
+	auto deferred_asset_paths = std::set<std::string>();
 	for (auto &[texture_identifier, texture_with_last_update_time] : loaded_textures) {
+		if (!reload_all_textures && !changed_texture_asset_paths.contains(texture_identifier.asset_path)) {
+			continue;
+		}
+		if (pending_texture_reloads.contains(texture_identifier)) {
+			deferred_asset_paths.insert(texture_identifier.asset_path);
+			continue;
+		}
 		const auto complete_path = ASSETS_DIR + texture_identifier.asset_path;
 
-		if (const auto sp_texture = texture_with_last_update_time.texture.lock()) {
-			// update only, if the file has been modified
-			const auto last_write_time = std::filesystem::last_write_time(complete_path);
-			if (last_write_time > texture_with_last_update_time.last_update_time) {
-				sp_texture->update(Texture::image_data_from_file(complete_path));
-				texture_with_last_update_time.last_update_time = last_write_time;
+		if (texture_with_last_update_time.texture.lock()) {
+			// the watcher reported a change, otherwise update only if the file has been modified
+			// the file may not exist for a moment, while it is being replaced
+			std::error_code error;
+			const auto last_write_time = std::filesystem::last_write_time(complete_path, error);
+			if (!error && (!reload_all_textures
+				|| last_write_time > texture_with_last_update_time.last_update_time
+			)) {
+				// decoding large images takes long, don't block the frame
+				pending_texture_reloads.emplace(texture_identifier, TextureReload(
+					std::async(std::launch::async, Texture::image_data_from_file, complete_path),
+					last_write_time
+				));
 			}
 		}
 	}
+
+	reload_all_textures = false;
+	changed_texture_asset_paths = std::move(deferred_asset_paths);
 }
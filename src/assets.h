@@ -2,27 +2,53 @@
 
 #include <string>
 #include <memory>
+#include <set>
 
 #include "shader_program.h"
 #include "texture.h"
 
 namespace ron::assets {
 
+// loading and reloading may happen on different threads, they are serialized. loading an asset that
+// is loaded already updates it, like reloading does
+
 // asset_path example: "shaders/fancy_shader.vert"
 std::string read_text_file(const std::string& asset_path);
 
+// the defines are inserted after the #version directive of both shaders
+// every combination of asset paths and defines is only loaded once
 std::shared_ptr<ShaderProgram> load_shader_program(
-	const std::string &vertex_shader_asset_path, const std::string &fragment_shader_asset_path
+	const std::string &vertex_shader_asset_path, const std::string &fragment_shader_asset_path,
+	const std::set<std::string> &defines = {}
+);
+
+// loads the same shaders as shader_program with different defines
+// returns shader_program if it was not loaded with load_shader_program
+std::shared_ptr<ShaderProgram> load_shader_program_variant(
+	const std::shared_ptr<ShaderProgram> &shader_program, const std::set<std::string> &defines
 );
 
+// only files that changed since the last call are read again
+// (without watching every file is checked)
 void reload_shader_programs();
 
+// starts watching the files of loaded assets (and of assets loaded later) for changes, so
+// reloading only reads files that changed. nothing is watched until this is called
+void watch();
+// true after watch if changed files are reported by the platform. otherwise reloading checks every
+// file, which is too expensive to do every frame -> reload on demand instead (e.g. on a key press)
+bool is_watching();
+
 std::shared_ptr<Texture> load_texture(
 	const std::string &asset_path,
 	const Texture::MetaData &meta_data = Texture::MetaData::zero_initializer(),
 	const Texture::SampleData &sample_data = Texture::SampleData::zero_initializer()
 );
 
+// only files that changed since the last call are read again
+// (without watching every file is checked)
+// images are decoded in the background, textures are updated by a later call once decoding finished
+// -> call this once per frame
 void reload_textures();
 
 } // ron::assets
@@ -0,0 +1,311 @@
+#include "batch_renderer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "log.h"
+#include "perspective_camera.h"
+#include "profiler.h"
+
+using namespace ron;
+
+// bounding sphere of all mesh sections in world space, not the smallest one
+static BoundingSphere compute_scene_bounds(const Scene &scene) {
+	scene.update_transforms();
+	std::vector<BoundingSphere> spheres = {};
+	auto min = glm::vec3(FLT_MAX);
+	auto max = glm::vec3(-FLT_MAX);
+	for (const auto &mesh_node : scene.get_mesh_nodes()) {
+		const auto mesh = mesh_node->get_mesh();
+		if (!mesh) continue;
+		const auto model_matrix = mesh_node->get_model_matrix();
+		const auto scale = std::max(
+			{ glm::length(model_matrix[0]), glm::length(model_matrix[1]), glm::length(model_matrix[2]) }
+		);
+		for (const auto &mesh_section : mesh->sections) {
+			const auto center = glm::vec3(model_matrix * glm::vec4(mesh_section.bounds.center, 1.0f));
+			const auto radius = mesh_section.bounds.radius * scale;
+			spheres.push_back(BoundingSphere(center, radius));
+			min = glm::min(min, center - radius);
+			max = glm::max(max, center + radius);
+		}
+	}
+	if (spheres.empty()) {
+		return BoundingSphere(glm::vec3(0.0f), 1.0f);
+	}
+
+	BoundingSphere bounds = {};
+	bounds.center = 0.5f * (min + max);
+	for (const auto &sphere : spheres) {
+		bounds.radius = std::max(bounds.radius, glm::distance(bounds.center, sphere.center) + sphere.radius);
+	}
+	// e.g. a single point
+	bounds.radius = std::max(bounds.radius, 0.001f);
+	return bounds;
+}
+
+BatchRenderer::BatchRenderer(OpenGLRenderer &renderer) : BatchRenderer(renderer, Settings()) {}
+
+BatchRenderer::BatchRenderer(OpenGLRenderer &renderer, const Settings &settings)
+	: m_renderer(renderer), m_settings(settings),
+	m_atlas(std::make_unique<OpenGLRenderTarget>(OpenGLRenderTarget::Settings(settings.atlas_size))) {
+	m_import_thread = std::thread(&BatchRenderer::import_loop, this);
+}
+
+BatchRenderer::~BatchRenderer() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_import_available.notify_all();
+	m_import_thread.join();
+}
+
+void BatchRenderer::submit(const BatchJob &job) {
+	if (job.size.x == 0 || job.size.y == 0) {
+		log::error("Batch job " + std::to_string(job.id) + " has no pixels, it is skipped");
+		return;
+	}
+	if (!job.scene) {
+		std::lock_guard lock(m_mutex);
+		const auto [it, inserted] = m_scenes.try_emplace(job.scene_path);
+		auto &cached = it->second;
+		if (inserted) {
+			m_import_queue.push_back(job.scene_path);
+			m_import_available.notify_one();
+		}
+		else if (cached.scene && cached.queued_jobs == 0) {
+			// a cached scene is waiting for a job again
+			m_imported_ahead++;
+		}
+		cached.queued_jobs++;
+		cached.last_used = m_submission_count;
+	}
+	m_jobs.push_back(job);
+	m_pending_count++;
+	m_submission_count++;
+}
+
+void BatchRenderer::update() {
+	RON_PROFILE_ZONE("BatchRenderer::update");
+
+	std::vector<std::pair<BatchJob, std::shared_ptr<const Scene>>> ready_jobs = {};
+	{
+		std::lock_guard lock(m_mutex);
+		std::deque<BatchJob> waiting_jobs = {};
+		for (auto &job : m_jobs) {
+			auto scene = job.scene ? job.scene : m_scenes.at(job.scene_path).scene;
+			if (scene) {
+				ready_jobs.push_back(std::pair(std::move(job), std::move(scene)));
+			}
+			else {
+				waiting_jobs.push_back(std::move(job));
+			}
+		}
+		m_jobs = std::move(waiting_jobs);
+	}
+
+	for (const auto &[job, scene] : ready_jobs) {
+		render_job(job, *scene);
+		if (!job.scene) {
+			std::lock_guard lock(m_mutex);
+			release_scene(job.scene_path);
+		}
+	}
+	// nothing else can be rendered into the atlas before more scenes are imported
+	if (!m_atlas_tiles.empty()) {
+		read_atlas();
+	}
+
+	while (m_readback.poll(m_pixels)) {
+		split_pixels();
+	}
+}
+
+bool BatchRenderer::poll(BatchResult &result) {
+	if (m_results.empty()) {
+		return false;
+	}
+	result = std::move(m_results.front());
+	m_results.pop_front();
+	m_pending_count--;
+	return true;
+}
+
+bool BatchRenderer::wait(BatchResult &result) {
+	while (m_results.empty() && m_pending_count > 0) {
+		uint64_t import_count = 0;
+		{
+			std::lock_guard lock(m_mutex);
+			import_count = m_import_count;
+		}
+		update();
+		if (!m_results.empty()) break;
+
+		if (m_readback.wait(m_pixels)) {
+			split_pixels();
+		}
+		else {
+			// nothing is on the gpu, the jobs wait for their scenes
+			std::unique_lock lock(m_mutex);
+			m_import_finished.wait(lock, [&]() { return m_import_count != import_count; });
+		}
+	}
+	return poll(result);
+}
+
+void BatchRenderer::finish() {
+	while (true) {
+		uint64_t import_count = 0;
+		{
+			std::lock_guard lock(m_mutex);
+			import_count = m_import_count;
+		}
+		update();
+		if (m_jobs.empty()) break;
+
+		// the remaining jobs wait for their scenes
+		std::unique_lock lock(m_mutex);
+		m_import_finished.wait(lock, [&]() { return m_import_count != import_count; });
+	}
+	while (m_readback.wait(m_pixels)) {
+		split_pixels();
+	}
+}
+
+size_t BatchRenderer::get_pending_count() const { return m_pending_count; }
+
+void BatchRenderer::import_loop() {
+	RON_PROFILE_THREAD("batch import");
+	std::unique_lock lock(m_mutex);
+	while (true) {
+		m_import_available.wait(lock, [this]() {
+			return m_stop || (!m_import_queue.empty() && m_imported_ahead < m_settings.import_lookahead);
+		});
+		if (m_stop) return;
+
+		const auto scene_path = m_import_queue.front();
+		m_import_queue.pop_front();
+		lock.unlock();
+		auto scene = std::make_shared<const Scene>(gltf::import(scene_path, m_settings.import_settings));
+		lock.lock();
+
+		// queued entries are not evicted, the entry still exists
+		auto &cached = m_scenes.at(scene_path);
+		cached.scene = std::move(scene);
+		m_imported_ahead++;
+		m_import_count++;
+		m_import_finished.notify_all();
+	}
+}
+
+void BatchRenderer::render_job(const BatchJob &job, const Scene &scene) {
+	const auto aspect_ratio = static_cast<float>(job.size.x) / static_cast<float>(job.size.y);
+	auto camera = PerspectiveCamera(job.fov, aspect_ratio, job.near_clipping_plane, job.far_clipping_plane);
+	if (job.camera_model_matrix) {
+		camera.set_model_matrix(*job.camera_model_matrix);
+	}
+	else {
+		const auto bounds = compute_scene_bounds(scene);
+		// the narrower of the vertical and horizontal field of view decides the distance
+		const auto half_fov_y = glm::radians(job.fov) * 0.5f;
+		const auto half_fov = std::min(half_fov_y, std::atan(std::tan(half_fov_y) * aspect_ratio));
+		const auto distance = bounds.radius / std::sin(half_fov);
+		const auto direction = glm::normalize(job.view_direction);
+		// the up vector must not be parallel to the view direction
+		const auto up = std::abs(direction.y) > 0.999f
+			? glm::vec3(0.0f, 0.0f, -1.0f)
+			: glm::vec3(0.0f, 1.0f, 0.0f);
+		const auto position = bounds.center - direction * distance;
+		camera.set_model_matrix(glm::inverse(glm::lookAt(position, bounds.center, up)));
+		camera.set_near_clipping_plane(std::max(distance - bounds.radius, distance * 0.001f));
+		camera.set_far_clipping_plane(distance + bounds.radius);
+	}
+
+	// uploads only what the renderer has not seen yet, shader programs must be ready for the only frame
+	m_renderer.preload(scene);
+	m_renderer.wait_for_shader_programs();
+
+	if (job.size.x > m_settings.atlas_size.x || job.size.y > m_settings.atlas_size.y) {
+		// the copy is queued before the target is deleted, so it is not affected by the deletion
+		const auto target = OpenGLRenderTarget(OpenGLRenderTarget::Settings(job.size));
+		m_renderer.render(scene, camera, target);
+		const auto tag = m_readback_count++;
+		m_readback.read(target, tag);
+		m_reading_tiles[tag] = { Tile(job.id, glm::uvec4(0, 0, job.size)) };
+		return;
+	}
+
+	if (m_atlas_cursor.x + job.size.x > m_settings.atlas_size.x) {
+		m_atlas_cursor = glm::uvec2(0, m_atlas_cursor.y + m_atlas_row_height);
+		m_atlas_row_height = 0;
+	}
+	if (m_atlas_cursor.y + job.size.y > m_settings.atlas_size.y) {
+		read_atlas();
+	}
+	const auto viewport = glm::uvec4(m_atlas_cursor, job.size);
+	m_renderer.render(scene, camera, *m_atlas, viewport);
+	m_atlas_tiles.push_back(Tile(job.id, viewport));
+	m_atlas_cursor.x += job.size.x;
+	m_atlas_row_height = std::max(m_atlas_row_height, job.size.y);
+}
+
+void BatchRenderer::release_scene(const std::string &scene_path) {
+	auto &cached = m_scenes.at(scene_path);
+	assert(cached.queued_jobs > 0);
+	if (--cached.queued_jobs > 0) return;
+
+	m_imported_ahead--;
+	m_import_available.notify_one();
+
+	// evict the least recently used scenes without queued jobs
+	size_t cached_count = 0;
+	for (const auto &[path, entry] : m_scenes) {
+		if (entry.scene && entry.queued_jobs == 0) cached_count++;
+	}
+	for (; cached_count > m_settings.scene_cache_size; cached_count--) {
+		auto oldest = m_scenes.end();
+		for (auto it = m_scenes.begin(); it != m_scenes.end(); it++) {
+			if (it->second.scene && it->second.queued_jobs == 0
+				&& (oldest == m_scenes.end() || it->second.last_used < oldest->second.last_used)) {
+				oldest = it;
+			}
+		}
+		m_scenes.erase(oldest);
+	}
+}
+
+void BatchRenderer::read_atlas() {
+	// only the rows that were rendered into
+	const auto height = m_atlas_cursor.y + m_atlas_row_height;
+	const auto tag = m_readback_count++;
+	m_readback.read(*m_atlas, tag, glm::uvec4(0, 0, m_settings.atlas_size.x, height));
+	m_reading_tiles[tag] = std::move(m_atlas_tiles);
+	m_atlas_tiles.clear();
+	m_atlas_cursor = glm::uvec2(0);
+	m_atlas_row_height = 0;
+}
+
+void BatchRenderer::split_pixels() {
+	const auto node = m_reading_tiles.extract(m_pixels.tag);
+	assert(!node.empty());
+	for (const auto &tile : node.mapped()) {
+		BatchResult result = {};
+		result.id = tile.id;
+		result.size = glm::uvec2(tile.viewport.z, tile.viewport.w);
+		const auto row_size = static_cast<size_t>(result.size.x) * 4;
+		result.data.resize(row_size * result.size.y);
+		for (unsigned int row = 0; row < result.size.y; row++) {
+			// readback rows are bottom to top, result rows top to bottom
+			const auto source_row = tile.viewport.y + result.size.y - 1 - row;
+			const auto source_offset = (static_cast<size_t>(source_row) * m_pixels.size.x + tile.viewport.x) * 4;
+			std::memcpy(&result.data[row * row_size], &m_pixels.data[source_offset], row_size);
+		}
+		m_results.push_back(std::move(result));
+	}
+}
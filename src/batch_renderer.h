@@ -0,0 +1,133 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gltf.h"
+#include "opengl_rendering.h"
+#include "scene.h"
+
+namespace ron {
+
+struct BatchJob {
+	uint64_t id = 0; // passed on to the result
+	std::string scene_path = {}; // gltf file in the asset directory, imported in the background
+	std::shared_ptr<const Scene> scene = {}; // rendered instead of importing scene_path if set
+	glm::uvec2 size = glm::uvec2(256);
+	float fov = 40.0f; // vertical, in degrees
+	// nullopt -> the camera looks along view_direction at the center of the scene and is moved back
+	// until all mesh nodes are in view
+	std::optional<glm::mat4> camera_model_matrix = std::nullopt;
+	glm::vec3 view_direction = glm::vec3(-1.0f, -0.7f, -1.0f);
+	// only used with camera_model_matrix, framed cameras fit the clipping planes to the scene
+	float near_clipping_plane = 0.1f;
+	float far_clipping_plane = 1000.0f;
+};
+
+struct BatchResult {
+	uint64_t id = 0;
+	glm::uvec2 size = glm::uvec2(0);
+	std::vector<unsigned char> data = {}; // rgba8, rows from top to bottom like image files
+};
+
+// renders many small images (e.g. thumbnails) with one renderer:
+// - scenes are imported on a background thread while earlier jobs render. jobs with the same
+//   scene_path share one import and recently rendered scenes are kept for later jobs
+// - jobs are packed into tiles of a large render target, whose tiles are read back at once without
+//   waiting for the gpu (see OpenGLReadback). jobs larger than it get a render target of their own
+// tiles are cleared like the renderer clears (see OpenGLRenderer::auto_clear).
+// everything except the imports runs on the thread of the OpenGL context, which must exist until the
+// batch renderer is destroyed
+class BatchRenderer {
+public:
+	struct Settings {
+		gltf::ImportSettings import_settings = {};
+		glm::uvec2 atlas_size = glm::uvec2(2048);
+		// imported scenes whose jobs did not render yet, limits the memory used by long queues
+		unsigned int import_lookahead = 8;
+		// imported scenes kept after their jobs rendered, for later jobs with the same scene_path
+		unsigned int scene_cache_size = 32;
+	};
+
+	BatchRenderer(OpenGLRenderer &renderer);
+	BatchRenderer(OpenGLRenderer &renderer, const Settings &settings);
+	~BatchRenderer();
+	// forbid copying
+	BatchRenderer(const BatchRenderer&) = delete;
+	BatchRenderer &operator=(const BatchRenderer&) = delete;
+
+	// starts importing the scene of job if it is not cached or queued already
+	void submit(const BatchJob &job);
+	// renders the jobs whose scenes are imported and collects the results the gpu finished,
+	// never waits for imports or the gpu. jobs do not necessarily finish in submission order
+	void update();
+	// takes a finished result. false -> none is ready, call update
+	bool poll(BatchResult &result);
+	// takes a finished result, renders and waits for imports and the gpu until one is ready.
+	// false -> every submitted job was taken already
+	bool wait(BatchResult &result);
+	// renders all submitted jobs, returns once all of their results can be polled
+	void finish();
+	// submitted jobs whose results were not polled yet
+	size_t get_pending_count() const;
+private:
+	struct CachedScene {
+		std::shared_ptr<const Scene> scene = {}; // nullptr until imported
+		unsigned int queued_jobs = 0; // submitted jobs that were not rendered yet
+		uint64_t last_used = 0; // submission index of the latest job
+	};
+
+	struct Tile {
+		uint64_t id = 0;
+		glm::uvec4 viewport = glm::uvec4(0); // x, y, width, height from the bottom left corner
+	};
+
+	OpenGLRenderer &m_renderer;
+	const Settings m_settings;
+	std::deque<BatchJob> m_jobs = {}; // submitted, not rendered yet
+	size_t m_pending_count = 0;
+	uint64_t m_submission_count = 0;
+
+	// shelf packing, tiles are placed left to right in rows from the bottom
+	std::unique_ptr<OpenGLRenderTarget> m_atlas = {};
+	std::vector<Tile> m_atlas_tiles = {};
+	glm::uvec2 m_atlas_cursor = glm::uvec2(0);
+	unsigned int m_atlas_row_height = 0;
+
+	OpenGLReadback m_readback = {};
+	uint64_t m_readback_count = 0;
+	std::map<uint64_t, std::vector<Tile>> m_reading_tiles = {}; // by readback tag
+	OpenGLReadback::Pixels m_pixels = {}; // reused by every readback
+	std::deque<BatchResult> m_results = {};
+
+	// shared with the import thread
+	std::mutex m_mutex = {};
+	std::condition_variable m_import_available = {};
+	std::condition_variable m_import_finished = {};
+	std::unordered_map<std::string, CachedScene> m_scenes = {}; // by scene_path
+	std::deque<std::string> m_import_queue = {};
+	unsigned int m_imported_ahead = 0; // imported scenes with queued jobs
+	uint64_t m_import_count = 0;
+	bool m_stop = false;
+	std::thread m_import_thread = {};
+
+	void import_loop();
+	void render_job(const BatchJob &job, const Scene &scene);
+	// called for every rendered job with a scene_path, the lock must be held
+	void release_scene(const std::string &scene_path);
+	void read_atlas();
+	void split_pixels();
+};
+
+} // ron
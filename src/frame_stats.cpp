@@ -0,0 +1,57 @@
+#include "frame_stats.h"
+
+#include <cassert>
+
+using namespace ron;
+
+FrameStatsHistory::FrameStatsHistory(const size_t capacity) : m_capacity(std::max<size_t>(capacity, 1)) {
+	m_frames.reserve(m_capacity);
+}
+
+void FrameStatsHistory::add(const FrameStats &frame_stats) {
+	if (m_frames.size() < m_capacity) {
+		m_frames.push_back(frame_stats);
+	}
+	else {
+		m_frames[m_next] = frame_stats;
+	}
+	m_next = (m_next + 1) % m_capacity;
+}
+
+void FrameStatsHistory::clear() {
+	m_frames.clear();
+	m_next = 0;
+}
+
+size_t FrameStatsHistory::size() const { return m_frames.size(); }
+
+size_t FrameStatsHistory::get_capacity() const { return m_capacity; }
+
+const FrameStats &FrameStatsHistory::get(const size_t age) const {
+	assert(age < m_frames.size());
+	return m_frames[(m_next + m_capacity - 1 - age) % m_capacity];
+}
+
+FrameStatsHistory::Summary FrameStatsHistory::summarize_values(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return summarize_sorted(values);
+}
+
+FrameStatsHistory::Summary FrameStatsHistory::summarize_sorted(const std::vector<double> &sorted_values) {
+	if (sorted_values.empty()) return {};
+	double sum = 0.0;
+	for (const auto value : sorted_values) { sum += value; }
+	return Summary(
+		sorted_values.front(), sum / static_cast<double>(sorted_values.size()),
+		get_percentile(sorted_values, 50.0), get_percentile(sorted_values, 95.0),
+		get_percentile(sorted_values, 99.0), sorted_values.back()
+	);
+}
+
+double FrameStatsHistory::get_percentile(const std::vector<double> &sorted_values, const double percentile) {
+	if (sorted_values.empty()) return 0.0;
+	const auto rank = static_cast<size_t>(
+		std::ceil(percentile / 100.0 * static_cast<double>(sorted_values.size()))
+	);
+	return sorted_values[std::clamp<size_t>(rank, 1, sorted_values.size()) - 1];
+}
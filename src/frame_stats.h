@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ron {
+
+// work the renderer did for one frame (see OpenGLRenderer::get_frame_stats)
+struct FrameStats {
+	struct Pass {
+		unsigned int draw_calls = 0; // drawing the visible meshlets of a mesh section is one multi draw
+		unsigned int instances = 0; // drawn mesh sections
+		uint64_t triangles = 0;
+		unsigned int drawn_nodes = 0; // mesh nodes with at least one drawn mesh section
+		unsigned int culled_nodes = 0; // mesh nodes whose mesh sections were all culled
+	};
+
+	Pass shadow_pass = {};
+	Pass main_pass = {}; // includes the axes and the grid
+	unsigned int shadow_map_renders = 0;
+	unsigned int program_binds = 0;
+	unsigned int vertex_array_binds = 0;
+	unsigned int texture_binds = 0;
+	unsigned int uniform_uploads = 0;
+	// geometries, textures and transforms. uploads between two frames are counted for the next one
+	uint64_t uploaded_bytes = 0;
+	double cpu_time = 0.0; // milliseconds spent in render
+};
+
+// stats of the last frames, percentiles are more meaningful than the stats of single frames
+class FrameStatsHistory {
+public:
+	struct Summary {
+		double min = 0.0;
+		double mean = 0.0;
+		double median = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	FrameStatsHistory(const size_t capacity = 300);
+
+	// replaces the oldest frame once the history is full
+	void add(const FrameStats &frame_stats);
+	void clear();
+	size_t size() const;
+	size_t get_capacity() const;
+	// age 0 is the latest frame
+	const FrameStats &get(const size_t age) const;
+
+	// nearest rank percentile (0 - 100) of a value over the frames in the history, e.g.
+	// percentile(95.0, [](const FrameStats &stats) { return stats.main_pass.draw_calls; })
+	template <typename Function>
+	double percentile(const double percentile, const Function &get_value) const {
+		collect_sorted(get_value);
+		return get_percentile(m_values, percentile);
+	}
+	template <typename Function>
+	Summary summarize(const Function &get_value) const {
+		collect_sorted(get_value);
+		return summarize_sorted(m_values);
+	}
+	// the same for values that are not part of FrameStats, e.g. timings measured outside of the renderer
+	static Summary summarize_values(std::vector<double> values);
+private:
+	size_t m_capacity;
+	std::vector<FrameStats> m_frames = {}; // ring buffer
+	size_t m_next = 0; // index the next frame is written to
+	mutable std::vector<double> m_values = {}; // reused to avoid allocations
+
+	template <typename Function>
+	void collect_sorted(const Function &get_value) const {
+		m_values.clear();
+		for (const auto &frame_stats : m_frames) {
+			m_values.push_back(static_cast<double>(get_value(frame_stats)));
+		}
+		std::sort(m_values.begin(), m_values.end());
+	}
+	static Summary summarize_sorted(const std::vector<double> &sorted_values);
+	static double get_percentile(const std::vector<double> &sorted_values, const double percentile);
+};
+
+} // ron
@@ -7,15 +7,42 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <cassert>
+#include <chrono>
+#include <fstream>
 #include <unordered_map>
 
 #include "assets.h"
 #include "log.h"
+#include "profiler.h"
 
 #define ASSETS_DIR _ASSETS_DIR
 
 using namespace ron;
 
+// adds the time until stop (or the end of the scope) to a stage of gltf::ImportStats
+// time added to excluded in the meantime is subtracted, it was spent in a nested stage
+class StageTimer {
+public:
+	StageTimer(double *stage, const double *excluded = nullptr)
+		: m_stage(stage), m_excluded(excluded), m_excluded_begin(excluded ? *excluded : 0.0) {}
+	~StageTimer() { stop(); }
+	// forbid copying
+	StageTimer(const StageTimer&) = delete;
+	StageTimer &operator=(const StageTimer&) = delete;
+
+	void stop() {
+		if (!m_stage) return;
+		*m_stage += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_begin).count();
+		if (m_excluded) *m_stage -= *m_excluded - m_excluded_begin;
+		m_stage = nullptr;
+	}
+private:
+	double *m_stage; // nullptr -> not measured
+	const double *m_excluded;
+	double m_excluded_begin;
+	std::chrono::steady_clock::time_point m_begin = std::chrono::steady_clock::now();
+};
+
 static void extract_attributes(
 	const cgltf_primitive &primitive,
 	cgltf_accessor **pos_attribute, cgltf_accessor **normal_attribute,
@@ -122,12 +149,14 @@ static Texture::SampleData create_sample_data(const cgltf_sampler &sampler) {
 static std::shared_ptr<Texture> create_texture(
 	const cgltf_texture_view &gltf_texture_view,
 	std::unordered_map<cgltf_image*, std::shared_ptr<Texture>> &textures,
-	std::vector<std::string> &unsupported,
-	const std::string &gltf_path, bool srgb = true
+	std::vector<std::string> &unsupported, const std::string &gltf_path,
+	const gltf::ImportSettings &settings, gltf::ImportStats *stats, bool srgb = true
 ) {
 	if (textures.contains(gltf_texture_view.texture->image)) {
 		return textures[gltf_texture_view.texture->image];
 	}
+	RON_PROFILE_ZONE("load texture");
+	const StageTimer timer(stats ? &stats->image_decode : nullptr);
 
 	if (gltf_texture_view.has_transform) {
 		unsupported.push_back("Texture view transform");
@@ -155,6 +184,7 @@ static std::shared_ptr<Texture> create_texture(
 			),
 			sample_data
 		);
+		texture->residency = settings.texture_residency;
 		textures.emplace(gltf_texture_view.texture->image, texture);
 		return texture;
 	}
@@ -171,6 +201,7 @@ static std::shared_ptr<Texture> create_texture(
 			),
 			sample_data
 		);
+		texture->residency = settings.texture_residency;
 
 		return texture;
 	}
@@ -181,11 +212,12 @@ static std::shared_ptr<Material> create_material(
 	std::unordered_map<cgltf_image*, std::shared_ptr<Texture>> &textures,
 	std::unordered_map<cgltf_material*, std::shared_ptr<Material>> &materials,
 	std::vector<std::string> &unsupported,
-	const std::string &gltf_path
+	const std::string &gltf_path, const gltf::ImportSettings &settings, gltf::ImportStats *stats
 ) {
 	if (materials.contains(gltf_material)) {
 		return materials[gltf_material];
 	}
+	const StageTimer timer(stats ? &stats->materials : nullptr, stats ? &stats->image_decode : nullptr);
 
 	if (!gltf_material->has_pbr_metallic_roughness) {
 		unsupported.push_back("Material without pbrMetallicRoughness");
@@ -204,17 +236,10 @@ static std::shared_ptr<Material> create_material(
 	const auto &normal_tex = gltf_material->normal_texture;
 	if (normal_tex.texture) {
 		const auto texture = create_texture(
-			normal_tex, textures, unsupported, gltf_path, false
+			normal_tex, textures, unsupported, gltf_path, settings, stats, false
 		);
 		material->uniforms["normal_tex"] = make_uniform(texture);
 	}
-	else {
-		static const auto fallback_normal = assets::load_texture(
-			"default/textures/normal.png",
-			Texture::MetaData(Texture::Channels::AUTOMATIC, Texture::ColorSpace::NON_COLOR)
-		);
-		material->uniforms["normal_tex"] = ron::make_uniform(fallback_normal);
-	}
 
 	const auto &albedo_color = gltf_material->pbr_metallic_roughness.base_color_factor;
 	material->uniforms["albedo_color"] = make_uniform(glm::vec4(
@@ -223,15 +248,10 @@ static std::shared_ptr<Material> create_material(
 	const auto &albedo_tex = gltf_material->pbr_metallic_roughness.base_color_texture;
 	if (albedo_tex.texture) {
 		const auto texture = create_texture(
-			albedo_tex, textures, unsupported, gltf_path
+			albedo_tex, textures, unsupported, gltf_path, settings, stats
 		);
 		material->uniforms["albedo_tex"] = make_uniform(texture);
 	}
-	else {
-		material->uniforms["albedo_tex"] = ron::make_uniform(
-			assets::load_texture("default/textures/white.jpg")
-		);
-	}
 
 	const auto &metallic_factor = gltf_material->pbr_metallic_roughness.metallic_factor;
 	const auto &roughness_factor = gltf_material->pbr_metallic_roughness.roughness_factor;
@@ -240,16 +260,10 @@ static std::shared_ptr<Material> create_material(
 	const auto &metallic_roughness_tex = gltf_material->pbr_metallic_roughness.metallic_roughness_texture;
 	if (metallic_roughness_tex.texture) {
 		const auto texture = create_texture(
-			metallic_roughness_tex, textures, unsupported, gltf_path, false
+			metallic_roughness_tex, textures, unsupported, gltf_path, settings, stats, false
 		);
 		material->uniforms["metallic_roughness_tex"] = make_uniform(texture);
 	}
-	else {
-		material->uniforms["metallic_roughness_tex"]= ron::make_uniform(assets::load_texture(
-			"default/textures/white.jpg",
-			Texture::MetaData(Texture::Channels::AUTOMATIC, Texture::ColorSpace::NON_COLOR)
-		));
-	}
 
 	materials.emplace(gltf_material, material);
 
@@ -261,7 +275,7 @@ static void add_mesh_from_node(
 	std::unordered_map<cgltf_image*, std::shared_ptr<Texture>> &textures,
 	std::unordered_map<cgltf_material*, std::shared_ptr<Material>> &materials,
 	std::vector<std::string> &unsupported,
-	const std::string &gltf_path
+	const std::string &gltf_path, const gltf::ImportSettings &settings, gltf::ImportStats *stats
 ) {
 	for (size_t i = 0; i < node->mesh->primitives_count; i++) {
 		auto primitive = node->mesh->primitives[i];
@@ -278,6 +292,7 @@ static void add_mesh_from_node(
 		}
 
 		auto geometry = ron::Geometry();
+		auto unpack_timer = StageTimer(stats ? &stats->unpack : nullptr);
 
 		// load index data from storage buffer into geometry data
 		switch (primitive.indices->component_type) {
@@ -343,40 +358,75 @@ static void add_mesh_from_node(
 			);
 		}
 
+		unpack_timer.stop();
+
 		// if no tangent attribute is present, calculate if possible (normals and uvs required)
 		if (!tangent_attribute && normal_attribute && uv_attribute) {
+			RON_PROFILE_ZONE("generate tangents");
+			const StageTimer timer(stats ? &stats->tangents : nullptr);
 			geometry.tangents = generate_tangents(geometry);
 		}
 
+		{ // exporters often split vertices that are identical, merge them again
+			RON_PROFILE_ZONE("weld vertices");
+			const StageTimer timer(stats ? &stats->weld : nullptr);
+			weld_vertices(geometry);
+		}
+
 		const auto material = primitive.material
 			? create_material(
-				primitive.material, textures, materials, unsupported, gltf_path)
+				primitive.material, textures, materials, unsupported, gltf_path, settings, stats)
 			: nullptr;
 
-		out_mesh.sections.push_back(MeshSection(
-			std::make_shared<Geometry>(std::move(geometry)),
-			material
-		));
+		auto mesh_section = MeshSection(std::make_shared<Geometry>(std::move(geometry)), material);
+		// frustum culling needs the bounds, also without lods
+		mesh_section.bounds = compute_bounding_sphere(mesh_section.geometry->positions);
+		if (settings.generate_lods) {
+			RON_PROFILE_ZONE("generate lods");
+			const StageTimer timer(stats ? &stats->lods : nullptr);
+			generate_lods(mesh_section);
+		}
+		if (settings.build_meshlets) {
+			RON_PROFILE_ZONE("build meshlets");
+			const StageTimer timer(stats ? &stats->meshlets : nullptr);
+			build_meshlets(*mesh_section.geometry);
+			for (auto &lod : mesh_section.lods) {
+				build_meshlets(*lod.geometry);
+			}
+		}
+		mesh_section.geometry->residency = settings.geometry_residency;
+		for (auto &lod : mesh_section.lods) {
+			lod.geometry->residency = settings.geometry_residency;
+		}
+		out_mesh.sections.push_back(std::move(mesh_section));
 	}
 }
 
 static void add_all_meshes_from_node_recursive(
-	cgltf_node *node, Scene &scene,
+	cgltf_node *node, const TransformHierarchy::Id parent, Scene &scene,
 	std::unordered_map<cgltf_image*, std::shared_ptr<Texture>> &textures,
 	std::unordered_map<cgltf_material*, std::shared_ptr<Material>> &materials,
-	std::vector<std::string> &unsupported, const std::string &gltf_path
+	std::vector<std::string> &unsupported, const std::string &gltf_path,
+	const gltf::ImportSettings &settings, gltf::ImportStats *stats
 ) {
-	if (node->mesh) {
-		auto node_world_matrix = glm::identity<glm::mat4>();
-		cgltf_node_transform_world(node, reinterpret_cast<float *>(&node_world_matrix));
+	auto node_local_matrix = glm::identity<glm::mat4>();
+	cgltf_node_transform_local(node, reinterpret_cast<float *>(&node_local_matrix));
 
+	// the node keeps its place in the hierarchy, so its children can be moved with it
+	TransformHierarchy::Id transform;
+	if (node->mesh) {
 		auto mesh = std::make_shared<Mesh>();
-		add_mesh_from_node(node, *mesh, textures, materials, unsupported, gltf_path);
-		scene.add(std::make_shared<MeshNode>(mesh, node_world_matrix));
+		add_mesh_from_node(node, *mesh, textures, materials, unsupported, gltf_path, settings, stats);
+		const auto mesh_node = std::make_shared<MeshNode>(mesh, node_local_matrix);
+		scene.add(mesh_node, parent);
+		transform = mesh_node->get_transform_id();
+	}
+	else {
+		transform = scene.add_transform(node_local_matrix, parent);
 	}
 	for (size_t i = 0; i < node->children_count; i++) {
 		add_all_meshes_from_node_recursive(
-			node->children[i], scene, textures, materials, unsupported, gltf_path
+			node->children[i], transform, scene, textures, materials, unsupported, gltf_path, settings, stats
 		);
 	}
 }
@@ -398,14 +448,40 @@ static std::string result_to_string(cgltf_result result) {
 	}
 }
 
-Scene gltf::import(const std::string& path) {
+Scene gltf::import(const std::string& path, const ImportSettings &settings, ImportStats *stats) {
+	RON_PROFILE_ZONE("gltf::import");
+	const StageTimer total_timer(stats ? &stats->total : nullptr);
 	std::string full_path = ASSETS_DIR + path;
 	cgltf_options options = {};
 	cgltf_data* data = nullptr;
-	// parse gltf or glb file
-	auto parse_result = cgltf_parse_file(&options, full_path.c_str(), &data);
-	// load binary buffers
-	auto load_buffers_result = cgltf_load_buffers(&options, data, full_path.c_str());
+	cgltf_result parse_result = cgltf_result_file_not_found;
+	cgltf_result load_buffers_result = cgltf_result_success;
+	// read separately from parsing, so both can be measured. the parsed data points into the file
+	// data, it has to live until cgltf_free
+	std::vector<char> file_data = {};
+	{
+		RON_PROFILE_ZONE("parse glTF");
+		{
+			const StageTimer timer(stats ? &stats->file_read : nullptr);
+			std::ifstream file(full_path, std::ios::binary | std::ios::ate);
+			if (file) {
+				file_data.resize(static_cast<size_t>(file.tellg()));
+				file.seekg(0);
+				file.read(file_data.data(), static_cast<std::streamsize>(file_data.size()));
+				parse_result = file ? cgltf_result_success : cgltf_result_io_error;
+			}
+		}
+		if (parse_result == cgltf_result_success) {
+			// parse gltf or glb file
+			const StageTimer timer(stats ? &stats->parse : nullptr);
+			parse_result = cgltf_parse(&options, file_data.data(), file_data.size(), &data);
+		}
+		if (parse_result == cgltf_result_success) {
+			// load binary buffers
+			const StageTimer timer(stats ? &stats->load_buffers : nullptr);
+			load_buffers_result = cgltf_load_buffers(&options, data, full_path.c_str());
+		}
+	}
 
 	Scene scene = {};
 
@@ -424,7 +500,8 @@ Scene gltf::import(const std::string& path) {
 	for (size_t i = 0; i < data->scene->nodes_count; i++) {
 		auto node = data->scene->nodes[i];
 		add_all_meshes_from_node_recursive(
-			node, scene, textures, materials, unsupported_features, path
+			node, TransformHierarchy::invalid_id, scene, textures, materials,
+			unsupported_features, path, settings, stats
 		);
 	}
 
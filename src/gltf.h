@@ -4,6 +4,30 @@
 
 namespace ron::gltf {
 
-Scene import(const std::string& path);
+struct ImportSettings {
+	bool generate_lods = false; // see generate_lods
+	bool build_meshlets = false; // see build_meshlets, also applies to the lods
+	// applied to all imported geometries and textures, except the shared default textures
+	Residency geometry_residency = Residency::KEEP;
+	Residency texture_residency = Residency::KEEP;
+};
+
+// wall time spent in the stages of an import, in milliseconds
+struct ImportStats {
+	double file_read = 0.0;
+	double parse = 0.0; // cgltf_parse, the json and the glb header
+	double load_buffers = 0.0; // cgltf_load_buffers, reads external buffers
+	double unpack = 0.0; // indices and vertex attributes into geometries
+	double tangents = 0.0;
+	double weld = 0.0;
+	double lods = 0.0;
+	double meshlets = 0.0;
+	double image_decode = 0.0; // embedded images are decoded, external images are read and decoded
+	double materials = 0.0; // without the images they use
+	double total = 0.0;
+};
+
+// when stats is set, the times of the stages are added to it
+Scene import(const std::string& path, const ImportSettings &settings = {}, ImportStats *stats = nullptr);
 
 } // ron::gltf
@@ -0,0 +1,52 @@
+#include "headless_context.h"
+
+#include "log.h"
+
+using namespace ron;
+
+GLFWwindow *ron::create_headless_context(
+	const std::string &api, const glm::uvec2 size, const std::string &title
+) {
+	// without a window system GLFW's null platform is used, it creates EGL contexts on the surfaceless
+	// platform or OSMesa contexts. both run on software rasterizers like Mesa's llvmpipe.
+#if GLFW_VERSION_MAJOR > 3 || GLFW_VERSION_MINOR >= 4
+	if (api != "window") {
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
+#else
+	// the null platform was added in GLFW 3.4, older versions need a window system for every context
+	if (api != "window") {
+		log::warn(
+			"GLFW " + std::to_string(GLFW_VERSION_MAJOR) + "." + std::to_string(GLFW_VERSION_MINOR)
+			+ " has no null platform (GLFW 3.4 or later), the " + api + " context needs a window system"
+		);
+	}
+#endif
+	if (!glfwInit()) {
+		log::error("Failed to initialize GLFW");
+		return NULL;
+	}
+
+	// tell GLFW we are using OpenGL 4.6
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	// tell GLFW we want to use the core-profile -> no backwards-compatible features
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	if (api == "egl") {
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+	}
+	else if (api == "osmesa") {
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+	}
+
+	GLFWwindow *window = glfwCreateWindow(size.x, size.y, title.c_str(), NULL, NULL);
+	if (window == NULL) {
+		const char *description = NULL;
+		glfwGetError(&description);
+		log::error(
+			"Failed to create the " + api + " context: " + (description ? description : "unknown error")
+		);
+	}
+	return window;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h> // include glfw after glad
+
+#include <string>
+
+#include <glm/glm.hpp>
+
+namespace ron {
+
+// initializes GLFW and creates an invisible window with an OpenGL 4.6 core context for rendering
+// without a display. api selects how the context is created:
+//   egl: surfaceless EGL, osmesa: OSMesa, window: hidden window of the window system
+// returns NULL and logs the error if the context could not be created, glfwTerminate still has to be
+// called. the context is not made current.
+GLFWwindow *create_headless_context(const std::string &api, const glm::uvec2 size, const std::string &title);
+
+}
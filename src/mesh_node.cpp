@@ -14,11 +14,43 @@ MeshNode::MeshNode(const std::shared_ptr<Mesh> mesh, const glm::mat4 model_matri
 
 const std::shared_ptr<Mesh> MeshNode::get_mesh() const { return m_mesh; }
 
-glm::mat3 MeshNode::get_normal_local_to_world_matrix() const { return m_normal_local_to_world_matrix; }
+glm::mat3 MeshNode::get_normal_local_to_world_matrix() const {
+	if (m_transforms) return m_transforms->get_normal_matrix(m_transform_id);
+	return m_normal_local_to_world_matrix;
+}
 
-glm::mat4 MeshNode::get_model_matrix() const { return m_model_matrix; }
+glm::mat4 MeshNode::get_model_matrix() const {
+	if (m_transforms) return m_transforms->get_world_matrix(m_transform_id);
+	return m_model_matrix;
+}
 
 void MeshNode::set_model_matrix(glm::mat4 model_matrix) {
+	if (m_transforms) {
+		// convert to the space of the parent
+		const auto parent = m_transforms->get_parent(m_transform_id);
+		if (parent != TransformHierarchy::invalid_id) {
+			model_matrix = glm::inverse(m_transforms->get_world_matrix(parent)) * model_matrix;
+		}
+		m_transforms->set_local_matrix(m_transform_id, model_matrix);
+		return;
+	}
 	m_model_matrix = model_matrix;
 	m_normal_local_to_world_matrix = glm::transpose(glm::inverse(glm::mat3(m_model_matrix)));
 }
+
+glm::mat4 MeshNode::get_local_matrix() const {
+	if (m_transforms) return m_transforms->get_local_matrix(m_transform_id);
+	return m_model_matrix;
+}
+
+void MeshNode::set_local_matrix(const glm::mat4 &local_matrix) {
+	if (m_transforms) {
+		m_transforms->set_local_matrix(m_transform_id, local_matrix);
+		return;
+	}
+	set_model_matrix(local_matrix);
+}
+
+MeshNodeId MeshNode::get_scene_id() const { return m_scene_id; }
+
+TransformHierarchy::Id MeshNode::get_transform_id() const { return m_transform_id; }
@@ -0,0 +1,328 @@
+#include "meshes.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+using namespace ron;
+
+// how strongly differences in normals and uvs are penalized compared to the geometric error
+// the geometric error is a squared distance, the attribute error is scaled by the squared bounding
+// radius to have the same unit and to make it independent of the size
+static const double attribute_weight = 0.01;
+// stop after this many passes, even if the target was not reached
+static const unsigned int max_passes = 64;
+
+// symmetric 4x4 matrix that measures the squared distance of a point to a set of planes
+// Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997
+// the planes are weighted, the error is their weighted mean -> a squared distance in object space
+struct Quadric {
+	double a2 = 0.0, b2 = 0.0, c2 = 0.0, ab = 0.0, ac = 0.0, bc = 0.0;
+	double ad = 0.0, bd = 0.0, cd = 0.0, d2 = 0.0;
+	double weight = 0.0;
+
+	static Quadric from_plane(const glm::dvec3 &normal, const double distance, const double weight) {
+		const auto &n = normal;
+		const auto d = distance;
+		return {
+			n.x * n.x * weight, n.y * n.y * weight, n.z * n.z * weight,
+			n.x * n.y * weight, n.x * n.z * weight, n.y * n.z * weight,
+			n.x * d * weight, n.y * d * weight, n.z * d * weight, d * d * weight, weight
+		};
+	}
+
+	Quadric & operator+=(const Quadric &rhs) {
+		a2 += rhs.a2; b2 += rhs.b2; c2 += rhs.c2; ab += rhs.ab; ac += rhs.ac; bc += rhs.bc;
+		ad += rhs.ad; bd += rhs.bd; cd += rhs.cd; d2 += rhs.d2;
+		weight += rhs.weight;
+		return *this;
+	}
+
+	Quadric operator+(const Quadric &rhs) const {
+		auto result = *this;
+		return result += rhs;
+	}
+
+	double error(const glm::vec3 &point) const {
+		if (weight == 0.0) return 0.0;
+		const double x = point.x, y = point.y, z = point.z;
+		const double error = x * x * a2 + y * y * b2 + z * z * c2
+			+ 2.0 * (x * y * ab + x * z * ac + y * z * bc)
+			+ 2.0 * (x * ad + y * bd + z * cd)
+			+ d2;
+		return std::max(error / weight, 0.0); // may become slightly negative due to rounding
+	}
+};
+
+struct Collapse {
+	uint32_t from;
+	uint32_t to;
+	double cost;
+};
+
+struct PositionHash {
+	size_t operator()(const glm::vec3 &position) const {
+		uint32_t bits[3];
+		std::memcpy(bits, &position, sizeof(bits));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+};
+
+// vertices that share a position with another vertex (attribute seams) or that lie on an open
+// border can not be moved without tearing the surface -> lock them
+static std::vector<bool> find_locked_vertices(const Geometry &geometry) {
+	const auto vertex_count = geometry.positions.size();
+
+	std::vector<uint32_t> position_ids(vertex_count);
+	std::vector<uint32_t> position_vertex_counts = {};
+	std::unordered_map<glm::vec3, uint32_t, PositionHash> ids_by_position = {};
+	for (size_t i = 0; i < vertex_count; i++) {
+		const auto [it, inserted] = ids_by_position.try_emplace(
+			geometry.positions[i], static_cast<uint32_t>(position_vertex_counts.size())
+		);
+		if (inserted) { position_vertex_counts.push_back(0); }
+		position_ids[i] = it->second;
+		position_vertex_counts[it->second]++;
+	}
+
+	// an edge that is only used by a single triangle is a border edge
+	std::unordered_map<uint64_t, unsigned int> edge_use_counts = {};
+	const auto edge_key = [&](uint32_t a, uint32_t b) {
+		a = position_ids[a]; b = position_ids[b];
+		if (a > b) std::swap(a, b);
+		return (static_cast<uint64_t>(a) << 32) | b;
+	};
+	for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3) {
+		for (size_t e = 0; e < 3; e++) {
+			edge_use_counts[edge_key(geometry.indices[i + e], geometry.indices[i + (e + 1) % 3])]++;
+		}
+	}
+	std::vector<bool> border_positions(position_vertex_counts.size(), false);
+	for (const auto &[key, use_count] : edge_use_counts) {
+		if (use_count == 1) {
+			border_positions[key >> 32] = true;
+			border_positions[key & 0xffffffffu] = true;
+		}
+	}
+
+	std::vector<bool> locked(vertex_count);
+	for (size_t i = 0; i < vertex_count; i++) {
+		locked[i] = position_vertex_counts[position_ids[i]] > 1 || border_positions[position_ids[i]];
+	}
+	return locked;
+}
+
+// true if moving vertex "from" onto vertex "to" flips or degenerates one of the triangles around it
+static bool collapse_flips_triangle(
+	const Geometry &geometry, const std::vector<uint32_t> &indices,
+	const std::vector<uint32_t> &adjacency_offsets, const std::vector<uint32_t> &adjacency,
+	const uint32_t from, const uint32_t to
+) {
+	const auto &new_position = geometry.positions[to];
+	for (auto i = adjacency_offsets[from]; i < adjacency_offsets[from + 1]; i++) {
+		const auto triangle = adjacency[i];
+		const uint32_t *t = &indices[triangle * 3];
+		if (t[0] == to || t[1] == to || t[2] == to) {
+			continue; // this triangle will be removed by the collapse
+		}
+		glm::vec3 before[3]; glm::vec3 after[3];
+		for (int k = 0; k < 3; k++) {
+			before[k] = geometry.positions[t[k]];
+			after[k] = t[k] == from ? new_position : before[k];
+		}
+		const auto normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+		const auto normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+		if (glm::dot(normal_before, normal_after) <= 0.0f) {
+			return true;
+		}
+	}
+	return false;
+}
+
+BoundingSphere ron::compute_bounding_sphere(const std::vector<glm::vec3> &positions) {
+	if (positions.empty()) {
+		return {};
+	}
+	auto min = positions[0];
+	auto max = positions[0];
+	for (const auto &position : positions) {
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+	BoundingSphere sphere = { (min + max) * 0.5f, 0.0f };
+	for (const auto &position : positions) {
+		sphere.radius = std::max(sphere.radius, glm::length(position - sphere.center));
+	}
+	return sphere;
+}
+
+GeometryLOD ron::simplify(
+	const Geometry &geometry, const size_t target_index_count, const float max_error
+) {
+	const auto vertex_count = static_cast<uint32_t>(geometry.positions.size());
+	assert(geometry.indices.size() % 3 == 0);
+
+	const auto locked = find_locked_vertices(geometry);
+	const double radius = compute_bounding_sphere(geometry.positions).radius;
+	const double attribute_scale = attribute_weight * radius * radius;
+	const double max_cost = static_cast<double>(max_error) * max_error;
+
+	std::vector<Quadric> quadrics(vertex_count);
+	for (size_t i = 0; i < geometry.indices.size(); i += 3) {
+		const glm::dvec3 p0 = glm::dvec3(geometry.positions[geometry.indices[i + 0]]);
+		const glm::dvec3 p1 = glm::dvec3(geometry.positions[geometry.indices[i + 1]]);
+		const glm::dvec3 p2 = glm::dvec3(geometry.positions[geometry.indices[i + 2]]);
+		const auto cross = glm::cross(p1 - p0, p2 - p0);
+		const auto double_area = glm::length(cross);
+		if (double_area == 0.0) continue;
+		const auto normal = cross / double_area;
+		// weight by area, so small triangles do not dominate the error. the weights are normalized
+		// in Quadric::error, so they do not change its unit
+		const auto quadric = Quadric::from_plane(normal, -glm::dot(normal, p0), double_area * 0.5);
+		for (int k = 0; k < 3; k++) { quadrics[geometry.indices[i + k]] += quadric; }
+	}
+
+	const auto attribute_error = [&](const uint32_t a, const uint32_t b) {
+		double error = 0.0;
+		if (!geometry.normals.empty()) {
+			const auto d = geometry.normals[a] - geometry.normals[b];
+			error += glm::dot(d, d);
+		}
+		if (!geometry.uvs.empty()) {
+			const auto d = geometry.uvs[a] - geometry.uvs[b];
+			error += glm::dot(d, d);
+		}
+		return error * attribute_scale;
+	};
+
+	auto indices = geometry.indices;
+	double result_cost = 0.0;
+
+	for (unsigned int pass = 0; pass < max_passes && indices.size() > target_index_count; pass++) {
+		const auto triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+		// vertex -> triangles adjacency in compressed form
+		std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+		for (const auto &index : indices) { adjacency_offsets[index + 1]++; }
+		for (uint32_t v = 0; v < vertex_count; v++) { adjacency_offsets[v + 1] += adjacency_offsets[v]; }
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			auto fill = adjacency_offsets;
+			for (size_t i = 0; i < indices.size(); i++) { adjacency[fill[indices[i]]++] = i / 3; }
+		}
+
+		std::vector<Collapse> collapses = {};
+		collapses.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			for (size_t e = 0; e < 3; e++) {
+				const auto from = indices[i + e];
+				const auto to = indices[i + (e + 1) % 3];
+				if (locked[from] || from == to) continue;
+				// the merged quadric, like the one "to" gets after the collapse, so the error already
+				// accumulated around "to" makes collapses into simplified regions more expensive
+				const auto cost = (quadrics[from] + quadrics[to]).error(geometry.positions[to])
+					+ attribute_error(from, to);
+				if (cost > max_cost) continue;
+				collapses.push_back({ from, to, cost });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+			return a.cost < b.cost;
+		});
+
+		// every collapse changes the triangles around "from", so collapses in the same pass must
+		// not share any of these vertices, otherwise the flip test would be based on stale data
+		const auto triangles_to_remove = (indices.size() - target_index_count + 2) / 3;
+		size_t removed_triangles = 0;
+		std::vector<bool> touched(vertex_count, false);
+		std::vector<uint32_t> remap(vertex_count);
+		for (uint32_t v = 0; v < vertex_count; v++) { remap[v] = v; }
+
+		for (const auto &collapse : collapses) {
+			if (removed_triangles >= triangles_to_remove) break;
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+			if (collapse_flips_triangle(
+				geometry, indices, adjacency_offsets, adjacency, collapse.from, collapse.to
+			)) continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			result_cost = std::max(result_cost, collapse.cost);
+
+			for (auto i = adjacency_offsets[collapse.from]; i < adjacency_offsets[collapse.from + 1]; i++) {
+				const uint32_t *t = &indices[adjacency[i] * 3];
+				if (t[0] == collapse.to || t[1] == collapse.to || t[2] == collapse.to) {
+					removed_triangles++;
+				}
+				touched[t[0]] = true; touched[t[1]] = true; touched[t[2]] = true;
+			}
+		}
+
+		if (removed_triangles == 0) {
+			break; // no valid collapse left
+		}
+
+		// apply the collapses and remove degenerate triangles
+		std::vector<uint32_t> new_indices = {};
+		new_indices.reserve(indices.size());
+		for (uint32_t t = 0; t < triangle_count; t++) {
+			const auto a = remap[indices[t * 3 + 0]];
+			const auto b = remap[indices[t * 3 + 1]];
+			const auto c = remap[indices[t * 3 + 2]];
+			if (a == b || b == c || a == c) continue;
+			new_indices.push_back(a); new_indices.push_back(b); new_indices.push_back(c);
+		}
+		indices = std::move(new_indices);
+	}
+
+	// only keep vertices that are still referenced
+	auto simplified = std::make_shared<Geometry>();
+	std::vector<uint32_t> compact_remap(vertex_count, std::numeric_limits<uint32_t>::max());
+	for (auto &index : indices) {
+		if (compact_remap[index] == std::numeric_limits<uint32_t>::max()) {
+			compact_remap[index] = static_cast<uint32_t>(simplified->positions.size());
+			simplified->positions.push_back(geometry.positions[index]);
+			if (!geometry.normals.empty()) simplified->normals.push_back(geometry.normals[index]);
+			if (!geometry.uvs.empty()) simplified->uvs.push_back(geometry.uvs[index]);
+			if (!geometry.tangents.empty()) simplified->tangents.push_back(geometry.tangents[index]);
+		}
+		index = compact_remap[index];
+	}
+	simplified->indices = std::move(indices);
+
+	return { simplified, static_cast<float>(std::sqrt(result_cost)) };
+}
+
+void ron::generate_lods(
+	MeshSection &mesh_section, const unsigned int max_lod_count, const float reduction_per_lod
+) {
+	assert(mesh_section.geometry);
+	assert(reduction_per_lod > 0.0f && reduction_per_lod < 1.0f);
+
+	mesh_section.bounds = compute_bounding_sphere(mesh_section.geometry->positions);
+	mesh_section.lods.clear();
+
+	auto previous = mesh_section.geometry;
+	float previous_error = 0.0f;
+	for (unsigned int i = 0; i < max_lod_count; i++) {
+		const auto previous_index_count = previous->indices.size();
+		const auto target_index_count = static_cast<size_t>(previous_index_count * reduction_per_lod);
+
+		// simplify the previous lod instead of the original geometry, this is a lot faster
+		// the errors add up, because the error is measured relative to the previous lod
+		auto lod = simplify(*previous, target_index_count);
+		lod.error += previous_error;
+
+		// stop if the mesh could not be reduced much further (e.g. because most vertices are locked)
+		if (lod.geometry->indices.empty() || lod.geometry->indices.size() > previous_index_count * 0.9f) {
+			break;
+		}
+
+		previous = lod.geometry;
+		previous_error = lod.error;
+		mesh_section.lods.push_back(std::move(lod));
+	}
+}
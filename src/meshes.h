@@ -3,14 +3,35 @@
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <limits>
 
 #include <glm/glm.hpp>
 
 #include "material.h"
 #include "i_spatial.h"
+#include "residency.h"
+#include "transform_hierarchy.h"
 
 namespace ron {
 
+struct BoundingSphere {
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+BoundingSphere compute_bounding_sphere(const std::vector<glm::vec3> &positions);
+
+// a small cluster of triangles that can be culled on its own
+struct Meshlet {
+	uint32_t index_offset = 0; // first index of the meshlet in Geometry::indices
+	uint32_t index_count = 0;
+	BoundingSphere bounds = {};
+	// all triangles face away from viewers for which
+	// dot(normalize(bounds.center - viewer), cone_axis) >= cone_cutoff
+	glm::vec3 cone_axis = glm::vec3(0.0f);
+	float cone_cutoff = 1.0f; // 1.0 -> never cull
+};
+
 struct Geometry {
 	std::vector<glm::vec3> positions = {};
 	std::vector<glm::vec3> normals = {}; // optional - may be empty
@@ -18,19 +39,90 @@ struct Geometry {
 	std::vector<glm::vec4> tangents = {}; // optional - may be empty
 
 	std::vector<uint32_t> indices = {};
+
+	std::vector<Meshlet> meshlets = {}; // optional - may be empty (see build_meshlets)
+
+	// the renderer calls release_geometry_data after uploading unless this is KEEP
+	Residency residency = Residency::KEEP;
+	bool released = false;
+	// only set while released with RELOAD_FROM_SOURCE_ON_DEMAND
+	std::shared_ptr<const std::string> cooked_cache_path = {};
 };
 
+// frees the vertex attributes and indices according to geometry.residency
+// meshlets are kept, they are needed for culling
+// functions that read the vertex data must not be called on released geometry
+void release_geometry_data(Geometry &geometry);
+// loads released data from the cooked cache again, returns false if it can not be restored
+bool restore_geometry_data(Geometry &geometry);
+
 std::vector<glm::vec4> generate_tangents(const Geometry &geometry);
 
+// merges vertices with identical attributes and rewrites the indices accordingly
+// with an epsilon > 0 attributes are snapped to a grid of that size before comparing
+// returns the remap table: old vertex index -> new vertex index
+std::vector<uint32_t> weld_vertices(Geometry &geometry, const float epsilon = 0.0f);
+
+// splits the geometry into meshlets of at most max_vertices unique vertices and max_triangles
+// triangles. the indices are reordered, so the triangles of every meshlet are contiguous
+void build_meshlets(Geometry &geometry, const size_t max_vertices = 64, const size_t max_triangles = 124);
+
+struct IndexRange {
+	uint32_t offset = 0;
+	uint32_t count = 0;
+};
+
+// appends the index ranges of all meshlets that intersect the frustum and, if cull_backfacing is
+// set, contain triangles that face the viewer. adjacent ranges are merged.
+void cull_meshlets(
+	const Geometry &geometry, const glm::mat4 &model_view_projection,
+	const glm::vec3 &object_space_viewer_position, const bool cull_backfacing,
+	std::vector<IndexRange> &out_ranges
+);
+
+struct GeometryLOD {
+	std::shared_ptr<Geometry> geometry = {};
+	float error = 0.0f; // approximate deviation from the original geometry in object space units
+};
+
+// reduces the triangle count using edge collapses ordered by quadric error,
+// differences in normals and uvs are added to the error
+// vertices on borders and attribute seams are not moved
+// stops when target_index_count is reached or no collapse with an error below max_error is left
+GeometryLOD simplify(
+	const Geometry &geometry, const size_t target_index_count,
+	const float max_error = std::numeric_limits<float>::max()
+);
+
 struct MeshSection {
 	std::shared_ptr<Geometry> geometry = {};
 	std::shared_ptr<Material> material = {};
+	// optional, increasingly coarse versions of geometry (see generate_lods)
+	std::vector<GeometryLOD> lods = {};
+	BoundingSphere bounds = {}; // object space bounds of geometry, used for lod selection and culling
 };
 
+// fills lods and bounds of the mesh section, every lod has reduction_per_lod times the triangles
+// of the previous one. less lods are generated if the geometry can not be simplified any further
+void generate_lods(
+	MeshSection &mesh_section, const unsigned int max_lod_count = 4, const float reduction_per_lod = 0.5f
+);
+
 struct Mesh {
 	std::vector<MeshSection> sections;
 };
 
+// stable identifier of a mesh node in a scene, stays valid until the node is removed
+// the generation tells apart nodes that were added to the same slot at different times
+struct MeshNodeId {
+	static constexpr uint32_t invalid_index = UINT32_MAX;
+
+	uint32_t index = invalid_index;
+	uint32_t generation = 0;
+
+	bool operator==(const MeshNodeId &other) const = default;
+};
+
 class MeshNode : public ISpatial {
 public:
 	MeshNode();
@@ -41,12 +133,29 @@ public:
 	glm::mat3 get_normal_local_to_world_matrix() const;
 
 	// ISpatial
+	// the model matrix is the world matrix, for nodes in a scene it includes the parent transforms
 	virtual glm::mat4 get_model_matrix() const override;
 	virtual void set_model_matrix(glm::mat4 model_matrix) override;
+
+	// relative to the parent transform, equals the model matrix for nodes without a parent
+	glm::mat4 get_local_matrix() const;
+	void set_local_matrix(const glm::mat4 &local_matrix);
+
+	// id and transform of the node in the scene it was added to
+	MeshNodeId get_scene_id() const;
+	TransformHierarchy::Id get_transform_id() const;
 private:
 	std::shared_ptr<Mesh> m_mesh;
+	// used while the node is not part of a scene
 	glm::mat4 m_model_matrix;
 	glm::mat3 m_normal_local_to_world_matrix;
+
+	// set while the node is part of a scene, the matrices are read from its transform hierarchy
+	std::shared_ptr<TransformHierarchy> m_transforms = nullptr;
+	TransformHierarchy::Id m_transform_id = TransformHierarchy::invalid_id;
+	MeshNodeId m_scene_id = {};
+
+	friend class Scene;
 };
 
 } // ron
@@ -0,0 +1,209 @@
+#include "meshes.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using namespace ron;
+
+static const uint32_t no_meshlet = std::numeric_limits<uint32_t>::max();
+
+static Meshlet create_meshlet(
+	const Geometry &geometry, const std::vector<uint32_t> &meshlet_indices,
+	const uint32_t index_offset
+) {
+	Meshlet meshlet = {};
+	meshlet.index_offset = index_offset;
+	meshlet.index_count = static_cast<uint32_t>(meshlet_indices.size());
+
+	std::vector<glm::vec3> positions = {};
+	positions.reserve(meshlet_indices.size());
+	for (const auto &index : meshlet_indices) { positions.push_back(geometry.positions[index]); }
+	meshlet.bounds = compute_bounding_sphere(positions);
+
+	// the cone axis is the average triangle normal, the cutoff is derived from the normal that
+	// deviates the most from it
+	std::vector<glm::vec3> normals = {};
+	normals.reserve(meshlet_indices.size() / 3);
+	auto axis = glm::vec3(0.0f);
+	for (size_t i = 0; i < meshlet_indices.size(); i += 3) {
+		const auto &p0 = positions[i];
+		const auto normal = glm::cross(positions[i + 1] - p0, positions[i + 2] - p0);
+		const auto length = glm::length(normal);
+		if (length == 0.0f) continue;
+		normals.push_back(normal / length);
+		axis += normals.back();
+	}
+	const auto axis_length = glm::length(axis);
+	if (normals.empty() || axis_length == 0.0f) {
+		return meshlet; // the cone is undefined, never cull
+	}
+	axis /= axis_length;
+
+	float min_dot = 1.0f;
+	for (const auto &normal : normals) { min_dot = std::min(min_dot, glm::dot(axis, normal)); }
+	// if the normals spread over (almost) a half sphere, the cone is too wide to ever cull anything
+	if (min_dot <= 0.1f) {
+		return meshlet;
+	}
+	meshlet.cone_axis = axis;
+	// sin of the cone half angle = cos of the angle between the cone and its backfacing region
+	meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+	return meshlet;
+}
+
+void ron::build_meshlets(Geometry &geometry, const size_t max_vertices, const size_t max_triangles) {
+	assert(geometry.indices.size() % 3 == 0);
+	assert(max_vertices >= 3 && max_triangles >= 1);
+
+	const auto vertex_count = geometry.positions.size();
+	const auto triangle_count = geometry.indices.size() / 3;
+	const auto &indices = geometry.indices;
+
+	// vertex -> triangles adjacency in compressed form
+	std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+	for (const auto &index : indices) { adjacency_offsets[index + 1]++; }
+	for (size_t v = 0; v < vertex_count; v++) { adjacency_offsets[v + 1] += adjacency_offsets[v]; }
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		auto fill = adjacency_offsets;
+		for (size_t i = 0; i < indices.size(); i++) { adjacency[fill[indices[i]]++] = i / 3; }
+	}
+
+	std::vector<bool> triangle_used(triangle_count, false);
+	// the meshlet a vertex was last added to, used to count the new vertices of a triangle
+	std::vector<uint32_t> vertex_meshlet(vertex_count, no_meshlet);
+
+	std::vector<uint32_t> reordered_indices = {};
+	reordered_indices.reserve(indices.size());
+	std::vector<uint32_t> meshlet_indices = {};
+	std::vector<uint32_t> candidates = {};
+	geometry.meshlets.clear();
+
+	size_t next_seed = 0;
+	while (true) {
+		while (next_seed < triangle_count && triangle_used[next_seed]) { next_seed++; }
+		if (next_seed == triangle_count) break;
+
+		const auto meshlet_id = static_cast<uint32_t>(geometry.meshlets.size());
+		size_t meshlet_vertex_count = 0;
+		meshlet_indices.clear();
+		candidates.clear();
+
+		const auto new_vertex_count = [&](const uint32_t triangle) {
+			unsigned int count = 0;
+			for (int k = 0; k < 3; k++) {
+				if (vertex_meshlet[indices[triangle * 3 + k]] != meshlet_id) count++;
+			}
+			return count;
+		};
+
+		// grow the meshlet greedily, always adding the neighbouring triangle that adds the fewest
+		// new vertices. this keeps meshlets compact, which makes their bounds and cones tight
+		auto triangle = static_cast<uint32_t>(next_seed);
+		while (true) {
+			triangle_used[triangle] = true;
+			for (int k = 0; k < 3; k++) {
+				const auto vertex = indices[triangle * 3 + k];
+				if (vertex_meshlet[vertex] != meshlet_id) {
+					vertex_meshlet[vertex] = meshlet_id;
+					meshlet_vertex_count++;
+				}
+				meshlet_indices.push_back(vertex);
+				for (auto i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1]; i++) {
+					if (!triangle_used[adjacency[i]]) candidates.push_back(adjacency[i]);
+				}
+			}
+			if (meshlet_indices.size() / 3 >= max_triangles) break;
+
+			uint32_t best = no_meshlet;
+			unsigned int best_new_vertices = 4;
+			size_t write = 0;
+			for (size_t i = 0; i < candidates.size(); i++) {
+				const auto candidate = candidates[i];
+				if (triangle_used[candidate]) continue;
+				candidates[write++] = candidate; // drop used candidates while iterating
+				const auto new_vertices = new_vertex_count(candidate);
+				if (new_vertices < best_new_vertices) {
+					best = candidate;
+					best_new_vertices = new_vertices;
+				}
+			}
+			candidates.resize(write);
+
+			if (best == no_meshlet) {
+				// no neighbour left, continue with the next unused triangle if it fits
+				while (next_seed < triangle_count && triangle_used[next_seed]) { next_seed++; }
+				if (next_seed == triangle_count) break;
+				best = static_cast<uint32_t>(next_seed);
+				best_new_vertices = new_vertex_count(best);
+			}
+			if (meshlet_vertex_count + best_new_vertices > max_vertices) break;
+			triangle = best;
+		}
+
+		geometry.meshlets.push_back(create_meshlet(
+			geometry, meshlet_indices, static_cast<uint32_t>(reordered_indices.size())
+		));
+		reordered_indices.insert(reordered_indices.end(), meshlet_indices.begin(), meshlet_indices.end());
+	}
+
+	geometry.indices = std::move(reordered_indices);
+}
+
+void ron::cull_meshlets(
+	const Geometry &geometry, const glm::mat4 &model_view_projection,
+	const glm::vec3 &object_space_viewer_position, const bool cull_backfacing,
+	std::vector<IndexRange> &out_ranges
+) {
+	// extract the frustum planes in object space (Gribb and Hartmann)
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(
+			model_view_projection[0][i], model_view_projection[1][i],
+			model_view_projection[2][i], model_view_projection[3][i]
+		);
+	}
+	glm::vec4 planes[6] = {
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+	for (auto &plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	for (const auto &meshlet : geometry.meshlets) {
+		const auto &center = meshlet.bounds.center;
+		const auto radius = meshlet.bounds.radius;
+
+		bool visible = true;
+		for (const auto &plane : planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				visible = false;
+				break;
+			}
+		}
+		if (visible && cull_backfacing && meshlet.cone_cutoff < 1.0f) {
+			// all triangles face away from the viewer if dot(normalize(center - viewer), axis) >= cutoff
+			// the test is made conservative by the radius of the bounds
+			const auto to_center = center - object_space_viewer_position;
+			if (glm::dot(to_center, meshlet.cone_axis)
+				>= meshlet.cone_cutoff * glm::length(to_center) + radius
+			) {
+				visible = false;
+			}
+		}
+		if (!visible) continue;
+
+		// merge with the previous range if they are adjacent -> fewer draws
+		if (!out_ranges.empty()
+			&& out_ranges.back().offset + out_ranges.back().count == meshlet.index_offset
+		) {
+			out_ranges.back().count += meshlet.index_count;
+		}
+		else {
+			out_ranges.push_back({ meshlet.index_offset, meshlet.index_count });
+		}
+	}
+}
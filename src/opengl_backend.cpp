@@ -0,0 +1,261 @@
+#include "opengl_backend.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+using namespace ron;
+
+// functions without results or out parameters, the stubs only record them
+#define RON_OPENGL_DISCARDED_FUNCTIONS(X) \
+	X(glActiveTexture) X(glAttachShader) X(glBeginQuery) X(glBindBuffer) X(glBindBufferBase) \
+	X(glBindFramebuffer) X(glBindTexture) X(glBindVertexArray) X(glBlendFunc) X(glBufferData) \
+	X(glBufferSubData) X(glClear) X(glClearColor) X(glCompileShader) X(glCullFace) X(glDeleteBuffers) \
+	X(glDeleteFramebuffers) X(glDeleteProgram) X(glDeleteQueries) X(glDeleteShader) X(glDeleteSync) \
+	X(glDeleteTextures) X(glDeleteVertexArrays) X(glDepthFunc) X(glDetachShader) X(glDisable) \
+	X(glDrawArrays) X(glDrawBuffer) X(glDrawElements) X(glEnable) X(glEnableVertexAttribArray) \
+	X(glEndQuery) X(glFinish) X(glFlush) X(glFramebufferTexture2D) X(glGenerateMipmap) X(glLineWidth) \
+	X(glLinkProgram) X(glMultiDrawElements) X(glProgramBinary) X(glProgramParameteri) \
+	X(glQueryCounter) X(glReadBuffer) X(glReadPixels) X(glScissor) X(glShaderSource) X(glTexImage2D) \
+	X(glTexParameterfv) X(glTexParameteri) X(glUniform1f) X(glUniform1i) X(glUniform1ui) \
+	X(glUniform2f) X(glUniform2i) X(glUniform2ui) X(glUniform3f) X(glUniform3i) X(glUniform3ui) \
+	X(glUniform4f) X(glUniform4i) X(glUniform4ui) X(glUniformMatrix2fv) X(glUniformMatrix2x3fv) \
+	X(glUniformMatrix2x4fv) X(glUniformMatrix3fv) X(glUniformMatrix3x2fv) X(glUniformMatrix3x4fv) \
+	X(glUniformMatrix4fv) X(glUniformMatrix4x2fv) X(glUniformMatrix4x3fv) X(glUseProgram) \
+	X(glVertexAttribPointer) X(glViewport)
+
+static OpenGLRecording *active_recording = nullptr; // nullptr -> null backend
+static GLuint next_name = 1; // shared by all object types, 0 is never a valid name
+
+template <typename Argument>
+static double to_double(const Argument argument) {
+	if constexpr (std::is_pointer_v<Argument>) {
+		return static_cast<double>(reinterpret_cast<uintptr_t>(argument));
+	}
+	else {
+		return static_cast<double>(argument);
+	}
+}
+
+template <typename... Arguments>
+static void record(const char *name, const Arguments... arguments) {
+	if (!active_recording) return;
+	static_assert(sizeof...(Arguments) <= OpenGLCall::max_argument_count);
+	auto &call = active_recording->calls.emplace_back(OpenGLCall(name, {}, 0));
+	((call.arguments[call.argument_count++] = to_double(arguments)), ...);
+}
+
+template <typename Function>
+struct OpenGLStub;
+
+template <typename Result, typename... Arguments>
+struct OpenGLStub<Result (APIENTRY *)(Arguments...)> {
+	template <const char *name>
+	static Result APIENTRY discard(Arguments... arguments) {
+		record(name, arguments...);
+		if constexpr (!std::is_void_v<Result>) return Result();
+	}
+};
+
+// names with static storage duration, so they can be template arguments and stored in calls
+#define RON_OPENGL_NAME(function) static constexpr char function##_name[] = #function;
+RON_OPENGL_DISCARDED_FUNCTIONS(RON_OPENGL_NAME)
+
+// functions that return something, the results make the renderer believe everything worked
+
+static const GLubyte *APIENTRY get_string(const GLenum name) {
+	record("glGetString", name);
+	switch (name) {
+		// glad reads the version to decide which functions to load
+		case GL_VERSION: return reinterpret_cast<const GLubyte *>("4.6.0 ron");
+		case GL_SHADING_LANGUAGE_VERSION: return reinterpret_cast<const GLubyte *>("4.60 ron");
+		case GL_VENDOR: return reinterpret_cast<const GLubyte *>("ron");
+		case GL_RENDERER: return reinterpret_cast<const GLubyte *>(active_recording ? "recording" : "null");
+		default: return reinterpret_cast<const GLubyte *>("");
+	}
+}
+
+// glad fails to load without extensions. programs are compiled instantly, so the completion status
+// (GL_KHR_parallel_shader_compile) can always be reported
+static const char *const extension = "GL_KHR_parallel_shader_compile";
+
+static const GLubyte *APIENTRY get_string_i(const GLenum name, const GLuint index) {
+	record("glGetStringi", name, index);
+	return reinterpret_cast<const GLubyte *>(name == GL_EXTENSIONS && index == 0 ? extension : "");
+}
+
+static void APIENTRY get_integer(const GLenum name, GLint *data) {
+	record("glGetIntegerv", name, data);
+	// e.g. no program binary formats -> no shader cache
+	*data = name == GL_NUM_EXTENSIONS ? 1 : 0;
+}
+
+static void APIENTRY get_integer_64(const GLenum name, GLint64 *data) {
+	record("glGetInteger64v", name, data);
+	*data = 0;
+}
+
+static void APIENTRY get_shader(const GLuint shader, const GLenum name, GLint *parameters) {
+	record("glGetShaderiv", shader, name, parameters);
+	*parameters = name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+static void APIENTRY get_program(const GLuint program, const GLenum name, GLint *parameters) {
+	record("glGetProgramiv", program, name, parameters);
+	// GL_COMPLETION_STATUS_KHR is not part of the generated loader
+	*parameters = name == GL_LINK_STATUS || name == 0x91B1 ? GL_TRUE : 0;
+}
+
+template <const char *name>
+static void APIENTRY get_info_log(const GLuint object, const GLsizei size, GLsizei *length, GLchar *log) {
+	record(name, object, size, length, log);
+	if (size > 0) log[0] = '\0';
+	if (length) *length = 0;
+}
+
+static void APIENTRY get_program_binary(
+	const GLuint program, const GLsizei size, GLsizei *length, GLenum *format, void *binary
+) {
+	record("glGetProgramBinary", program, size, length, format, binary);
+	if (length) *length = 0;
+	*format = 0;
+}
+
+static void APIENTRY get_query_object(const GLuint query, const GLenum name, GLint *parameters) {
+	record("glGetQueryObjectiv", query, name, parameters);
+	*parameters = name == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void APIENTRY get_query_object_u64(const GLuint query, const GLenum name, GLuint64 *parameters) {
+	record("glGetQueryObjectui64v", query, name, parameters);
+	*parameters = 0;
+}
+
+static GLint APIENTRY get_uniform_location(const GLuint program, const GLchar *name) {
+	record("glGetUniformLocation", program, name);
+	return 0;
+}
+
+template <const char *name>
+static void APIENTRY generate_names(const GLsizei count, GLuint *names) {
+	record(name, count, names);
+	for (GLsizei i = 0; i < count; i++) { names[i] = next_name++; }
+}
+
+static GLuint APIENTRY create_shader(const GLenum type) {
+	record("glCreateShader", type);
+	return next_name++;
+}
+
+static GLuint APIENTRY create_program() {
+	record("glCreateProgram");
+	return next_name++;
+}
+
+static GLenum APIENTRY check_framebuffer_status(const GLenum target) {
+	record("glCheckFramebufferStatus", target);
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static GLsync APIENTRY fence_sync(const GLenum condition, const GLbitfield flags) {
+	record("glFenceSync", condition, flags);
+	return reinterpret_cast<GLsync>(static_cast<uintptr_t>(next_name++));
+}
+
+static GLenum APIENTRY client_wait_sync(const GLsync sync, const GLbitfield flags, const GLuint64 timeout) {
+	record("glClientWaitSync", sync, flags, timeout);
+	return GL_ALREADY_SIGNALED;
+}
+
+// readback buffers map to zeroed memory, it stays valid until a larger range is mapped
+static std::vector<unsigned char> mapped_memory = {};
+
+static void *APIENTRY map_buffer_range(
+	const GLenum target, const GLintptr offset, const GLsizeiptr length, const GLbitfield access
+) {
+	record("glMapBufferRange", target, offset, length, access);
+	if (mapped_memory.size() < static_cast<size_t>(length)) {
+		mapped_memory.resize(static_cast<size_t>(length));
+	}
+	return mapped_memory.data();
+}
+
+static GLboolean APIENTRY unmap_buffer(const GLenum target) {
+	record("glUnmapBuffer", target);
+	return GL_TRUE;
+}
+
+static constexpr char gen_buffers_name[] = "glGenBuffers";
+static constexpr char gen_framebuffers_name[] = "glGenFramebuffers";
+static constexpr char gen_queries_name[] = "glGenQueries";
+static constexpr char gen_textures_name[] = "glGenTextures";
+static constexpr char gen_vertex_arrays_name[] = "glGenVertexArrays";
+static constexpr char get_shader_info_log_name[] = "glGetShaderInfoLog";
+static constexpr char get_program_info_log_name[] = "glGetProgramInfoLog";
+
+struct OpenGLStubEntry {
+	const char *name;
+	void *function;
+};
+
+#define RON_OPENGL_DISCARDED_ENTRY(function) OpenGLStubEntry( \
+	#function, reinterpret_cast<void *>(&OpenGLStub<decltype(glad_##function)>::discard<function##_name>) \
+),
+
+static const OpenGLStubEntry stubs[] = {
+	RON_OPENGL_DISCARDED_FUNCTIONS(RON_OPENGL_DISCARDED_ENTRY)
+	OpenGLStubEntry("glGetString", reinterpret_cast<void *>(&get_string)),
+	OpenGLStubEntry("glGetStringi", reinterpret_cast<void *>(&get_string_i)),
+	OpenGLStubEntry("glGetIntegerv", reinterpret_cast<void *>(&get_integer)),
+	OpenGLStubEntry("glGetInteger64v", reinterpret_cast<void *>(&get_integer_64)),
+	OpenGLStubEntry("glGetShaderiv", reinterpret_cast<void *>(&get_shader)),
+	OpenGLStubEntry("glGetProgramiv", reinterpret_cast<void *>(&get_program)),
+	OpenGLStubEntry("glGetShaderInfoLog", reinterpret_cast<void *>(&get_info_log<get_shader_info_log_name>)),
+	OpenGLStubEntry("glGetProgramInfoLog", reinterpret_cast<void *>(&get_info_log<get_program_info_log_name>)),
+	OpenGLStubEntry("glGetProgramBinary", reinterpret_cast<void *>(&get_program_binary)),
+	OpenGLStubEntry("glGetQueryObjectiv", reinterpret_cast<void *>(&get_query_object)),
+	OpenGLStubEntry("glGetQueryObjectui64v", reinterpret_cast<void *>(&get_query_object_u64)),
+	OpenGLStubEntry("glGetUniformLocation", reinterpret_cast<void *>(&get_uniform_location)),
+	OpenGLStubEntry("glGenBuffers", reinterpret_cast<void *>(&generate_names<gen_buffers_name>)),
+	OpenGLStubEntry("glGenFramebuffers", reinterpret_cast<void *>(&generate_names<gen_framebuffers_name>)),
+	OpenGLStubEntry("glGenQueries", reinterpret_cast<void *>(&generate_names<gen_queries_name>)),
+	OpenGLStubEntry("glGenTextures", reinterpret_cast<void *>(&generate_names<gen_textures_name>)),
+	OpenGLStubEntry("glGenVertexArrays", reinterpret_cast<void *>(&generate_names<gen_vertex_arrays_name>)),
+	OpenGLStubEntry("glCreateShader", reinterpret_cast<void *>(&create_shader)),
+	OpenGLStubEntry("glCreateProgram", reinterpret_cast<void *>(&create_program)),
+	OpenGLStubEntry("glCheckFramebufferStatus", reinterpret_cast<void *>(&check_framebuffer_status)),
+	OpenGLStubEntry("glFenceSync", reinterpret_cast<void *>(&fence_sync)),
+	OpenGLStubEntry("glClientWaitSync", reinterpret_cast<void *>(&client_wait_sync)),
+	OpenGLStubEntry("glMapBufferRange", reinterpret_cast<void *>(&map_buffer_range)),
+	OpenGLStubEntry("glUnmapBuffer", reinterpret_cast<void *>(&unmap_buffer)),
+};
+
+size_t OpenGLRecording::count(const std::string_view name) const {
+	return std::count_if(calls.begin(), calls.end(), [&name](const OpenGLCall &call) { return call.name == name; });
+}
+
+void OpenGLRecording::clear() { calls.clear(); }
+
+void *ron::opengl_null_backend_get_proc(const char *name) {
+	for (const auto &stub : stubs) {
+		if (std::strcmp(stub.name, name) == 0) return stub.function;
+	}
+	return NULL;
+}
+
+bool ron::opengl_load_null_backend() {
+	active_recording = nullptr;
+	return gladLoadGLLoader(opengl_null_backend_get_proc);
+}
+
+bool ron::opengl_load_recording_backend(OpenGLRecording &recording) {
+	active_recording = &recording;
+	// glad queries the version while loading, that is not part of the recording
+	const bool loaded = gladLoadGLLoader(opengl_null_backend_get_proc);
+	recording.clear();
+	return loaded;
+}
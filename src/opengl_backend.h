@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ron {
+
+// every OpenGL call goes through the function pointers of glad, loading them from a backend instead of
+// the driver replaces OpenGL without touching the renderer. the backends do not need a context:
+// the null backend discards all calls, the recording backend also records them.
+// objects get unique names, shaders always compile and link and fences are always signaled.
+// functions that are not used by ron are not loaded (they stay NULL).
+// load them instead of the driver, before the renderer is created:
+//   opengl_load_null_backend();
+//   auto renderer = OpenGLRenderer(resolution);
+
+struct OpenGLCall {
+	static constexpr size_t max_argument_count = 10;
+
+	const char *name; // e.g. "glDrawElements"
+	// converted to double, pointers are stored as their address
+	std::array<double, max_argument_count> arguments;
+	uint8_t argument_count;
+};
+
+struct OpenGLRecording {
+	std::vector<OpenGLCall> calls = {};
+
+	size_t count(const std::string_view name) const;
+	void clear();
+};
+
+// a GLADloadproc, returns the functions of the null backend
+void *opengl_null_backend_get_proc(const char *name);
+
+// both return false if glad could not be loaded
+bool opengl_load_null_backend();
+// the calls are appended to recording until another backend is loaded, recording must outlive that
+bool opengl_load_recording_backend(OpenGLRecording &recording);
+
+} // ron
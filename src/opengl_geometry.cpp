@@ -5,6 +5,7 @@
 using namespace ron;
 
 OpenGLGeometryGPUData ron::opengl_setup_geometry(const Geometry &geometry) {
+	RON_PROFILE_ZONE("upload geometry");
 	OpenGLGeometryGPUData gpu_data = {};
 
 	static const GLint position_attrib_index = 0; // layout (location = 0)
@@ -18,6 +19,7 @@ OpenGLGeometryGPUData ron::opengl_setup_geometry(const Geometry &geometry) {
 	glBindVertexArray(gpu_data.vertex_array);
 
 	// indices
+	gpu_data.index_count = geometry.indices.size();
 	glGenBuffers(1, &gpu_data.index_buffer);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu_data.index_buffer);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
@@ -75,6 +77,12 @@ OpenGLGeometryGPUData ron::opengl_setup_geometry(const Geometry &geometry) {
 		glEnableVertexAttribArray(tangent_attrib_index);
 	}
 
+	gpu_data.byte_size = geometry.indices.size() * sizeof(GLuint)
+		+ geometry.positions.size() * sizeof(glm::vec3)
+		+ geometry.normals.size() * sizeof(glm::vec3)
+		+ geometry.uvs.size() * sizeof(glm::vec2)
+		+ geometry.tangents.size() * sizeof(glm::vec4);
+
 	// unbind buffers to avoid accidental modification
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -0,0 +1,96 @@
+#include "opengl_rendering.h"
+
+#include <cassert>
+
+using namespace ron;
+
+OpenGLGPUProfiler::~OpenGLGPUProfiler() {
+	for (const auto &frame : m_frames) {
+		for (const auto &query : frame.queries) {
+			m_free_queries.push_back(query.begin);
+			m_free_queries.push_back(query.end);
+		}
+	}
+	if (!m_free_queries.empty()) {
+		glDeleteQueries(static_cast<GLsizei>(m_free_queries.size()), m_free_queries.data());
+	}
+}
+
+void OpenGLGPUProfiler::begin_frame() {
+#ifdef RON_PROFILING
+	if (m_track == UINT32_MAX) {
+		m_track = profiler::create_track("GPU");
+	}
+
+	// the slot was used frame_count frames ago, its results are usually available by now
+	m_frame = (m_frame + 1) % frame_count;
+	auto &frame = m_frames[m_frame];
+	if (frame.pending) {
+		read_results(frame);
+	}
+
+	GLint64 gpu_time = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+	frame.cpu_minus_gpu_time = profiler::now() - gpu_time;
+#endif
+}
+
+void OpenGLGPUProfiler::end_frame() {
+#ifdef RON_PROFILING
+	assert(m_open_zones.empty());
+	auto &frame = m_frames[m_frame];
+	frame.pending = !frame.queries.empty();
+#endif
+}
+
+void OpenGLGPUProfiler::begin_zone(const char *name) {
+	auto &frame = m_frames[m_frame];
+	const auto query = get_query();
+	glQueryCounter(query, GL_TIMESTAMP);
+	m_open_zones.push_back(frame.queries.size());
+	frame.queries.push_back(Query(name, query, 0, static_cast<uint32_t>(m_open_zones.size() - 1)));
+}
+
+void OpenGLGPUProfiler::end_zone() {
+	assert(!m_open_zones.empty());
+	auto &query = m_frames[m_frame].queries[m_open_zones.back()];
+	m_open_zones.pop_back();
+	query.end = get_query();
+	glQueryCounter(query.end, GL_TIMESTAMP);
+}
+
+GLuint OpenGLGPUProfiler::get_query() {
+	if (m_free_queries.empty()) {
+		// queries are created in batches, they are reused once their results were read
+		m_free_queries.resize(32);
+		glGenQueries(static_cast<GLsizei>(m_free_queries.size()), m_free_queries.data());
+	}
+	const auto query = m_free_queries.back();
+	m_free_queries.pop_back();
+	return query;
+}
+
+void OpenGLGPUProfiler::read_results(Frame &frame) {
+	// timestamps are written in order, when the last one is available all of them are
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries.back().end, GL_QUERY_RESULT_AVAILABLE, &available);
+	for (const auto &query : frame.queries) {
+		if (available) {
+			GLuint64 begin = 0;
+			GLuint64 end = 0;
+			glGetQueryObjectui64v(query.begin, GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+			profiler::add_zone(
+				m_track, query.name,
+				static_cast<int64_t>(begin) + frame.cpu_minus_gpu_time,
+				static_cast<int64_t>(end) + frame.cpu_minus_gpu_time,
+				query.depth
+			);
+		}
+		// results that are not available yet are dropped, waiting for them would stall
+		m_free_queries.push_back(query.begin);
+		m_free_queries.push_back(query.end);
+	}
+	frame.queries.clear();
+	frame.pending = false;
+}
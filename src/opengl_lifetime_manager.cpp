@@ -0,0 +1,113 @@
+#include "opengl_rendering.h"
+
+#include <cassert>
+
+using namespace ron;
+
+OpenGLLifetimeManager::~OpenGLLifetimeManager() { flush(); }
+
+void OpenGLLifetimeManager::track(const ResourceType type) { m_live_counts[type]++; }
+
+void OpenGLLifetimeManager::release(OpenGLGeometryGPUData &gpu_data) {
+	assert(m_live_counts[GEOMETRY] > 0);
+	m_live_counts[GEOMETRY]--;
+	queue(BUFFER, gpu_data.index_buffer);
+	queue(BUFFER, gpu_data.positions_buffer);
+	queue(BUFFER, gpu_data.normals_buffer);
+	queue(BUFFER, gpu_data.uvs_buffer);
+	queue(BUFFER, gpu_data.tangents_buffer);
+	queue(VERTEX_ARRAY, gpu_data.vertex_array);
+	gpu_data = {};
+}
+
+void OpenGLLifetimeManager::release(OpenGLShaderProgramGPUData &gpu_data) {
+	assert(m_live_counts[SHADER_PROGRAM] > 0);
+	m_live_counts[SHADER_PROGRAM]--;
+	// shaders only exist while the program is still compiling
+	queue(SHADER, gpu_data.vertex_shader);
+	queue(SHADER, gpu_data.fragment_shader);
+	queue(PROGRAM, gpu_data.id);
+	gpu_data = {};
+}
+
+void OpenGLLifetimeManager::release(OpenGLTextureGPUData &gpu_data) {
+	assert(m_live_counts[TEXTURE] > 0);
+	m_live_counts[TEXTURE]--;
+	queue(TEXTURE_OBJECT, gpu_data.id);
+	gpu_data = {};
+}
+
+void OpenGLLifetimeManager::release(OpenGLDirectionalLightGPUData &gpu_data) {
+	assert(m_live_counts[DIRECTIONAL_LIGHT] > 0);
+	m_live_counts[DIRECTIONAL_LIGHT]--;
+	queue(FRAMEBUFFER, gpu_data.shadow_map_framebuffer);
+	queue(TEXTURE_OBJECT, gpu_data.shadow_map);
+	gpu_data = {};
+}
+
+void OpenGLLifetimeManager::release(OpenGLTransformBufferGPUData &gpu_data) {
+	assert(m_live_counts[TRANSFORM_BUFFER] > 0);
+	m_live_counts[TRANSFORM_BUFFER]--;
+	queue(BUFFER, gpu_data.buffer);
+	gpu_data = {};
+}
+
+void OpenGLLifetimeManager::queue(const ObjectType type, const GLuint name) {
+	if (name != 0) {
+		m_frame_deletions.push_back(Deletion(type, name));
+	}
+}
+
+void OpenGLLifetimeManager::end_frame() {
+	if (!m_frame_deletions.empty()) {
+		const auto fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_fenced_deletions.push_back(FencedDeletions(fence, std::move(m_frame_deletions)));
+		m_frame_deletions.clear();
+	}
+
+	// fences are passed in order, stop at the first one the gpu did not reach yet
+	while (!m_fenced_deletions.empty()) {
+		auto &oldest = m_fenced_deletions.front();
+		const auto status = glClientWaitSync(oldest.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(oldest.fence);
+		delete_objects(oldest.deletions);
+		m_fenced_deletions.pop_front();
+	}
+}
+
+void OpenGLLifetimeManager::flush() {
+	for (auto &fenced : m_fenced_deletions) {
+		glDeleteSync(fenced.fence);
+		delete_objects(fenced.deletions);
+	}
+	m_fenced_deletions.clear();
+	delete_objects(m_frame_deletions);
+	m_frame_deletions.clear();
+}
+
+unsigned int OpenGLLifetimeManager::get_live_count(const ResourceType type) const {
+	return m_live_counts[type];
+}
+
+size_t OpenGLLifetimeManager::get_pending_deletion_count() const {
+	size_t count = m_frame_deletions.size();
+	for (const auto &fenced : m_fenced_deletions) { count += fenced.deletions.size(); }
+	return count;
+}
+
+void OpenGLLifetimeManager::delete_objects(const std::vector<Deletion> &deletions) {
+	for (const auto &deletion : deletions) {
+		switch (deletion.type) {
+			case BUFFER: glDeleteBuffers(1, &deletion.name); break;
+			case VERTEX_ARRAY: glDeleteVertexArrays(1, &deletion.name); break;
+			case TEXTURE_OBJECT: glDeleteTextures(1, &deletion.name); break;
+			case FRAMEBUFFER: glDeleteFramebuffers(1, &deletion.name); break;
+			case PROGRAM: glDeleteProgram(deletion.name); break;
+			case SHADER: glDeleteShader(deletion.name); break;
+			default: assert(false); break;
+		}
+	}
+}
@@ -0,0 +1,189 @@
+#include "opengl_rendering.h"
+
+#include "log.h"
+
+#include <cstring>
+
+using namespace ron;
+
+OpenGLRenderTarget::OpenGLRenderTarget(const Settings &settings) : m_settings(settings) {
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+	if (m_settings.color_format != 0) {
+		glGenTextures(1, &m_color_texture);
+		glBindTexture(GL_TEXTURE_2D, m_color_texture);
+		// no mipmaps, so the texture is complete without generating them
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(
+			GL_TEXTURE_2D, 0, m_settings.color_format, m_settings.size.x, m_settings.size.y, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, NULL
+		);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color_texture, 0);
+	}
+	else {
+		// depth only, like the shadow maps
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+
+	if (m_settings.depth_format != 0) {
+		const bool stencil = m_settings.depth_format == GL_DEPTH24_STENCIL8
+			|| m_settings.depth_format == GL_DEPTH32F_STENCIL8;
+		glGenTextures(1, &m_depth_texture);
+		glBindTexture(GL_TEXTURE_2D, m_depth_texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(
+			GL_TEXTURE_2D, 0, m_settings.depth_format, m_settings.size.x, m_settings.size.y, 0,
+			stencil ? GL_DEPTH_STENCIL : GL_DEPTH_COMPONENT, stencil ? GL_UNSIGNED_INT_24_8 : GL_FLOAT, NULL
+		);
+		glFramebufferTexture2D(
+			GL_FRAMEBUFFER, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+			m_depth_texture, 0
+		);
+	}
+
+	const auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	m_complete = status == GL_FRAMEBUFFER_COMPLETE;
+	if (!m_complete) {
+		log::error("Render target framebuffer is incomplete (status " + std::to_string(status) + ")");
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+OpenGLRenderTarget::~OpenGLRenderTarget() {
+	glDeleteTextures(1, &m_color_texture);
+	glDeleteTextures(1, &m_depth_texture);
+	glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+const OpenGLRenderTarget::Settings & OpenGLRenderTarget::get_settings() const { return m_settings; }
+
+GLuint OpenGLRenderTarget::get_framebuffer() const { return m_framebuffer; }
+
+OpenGLTextureGPUData OpenGLRenderTarget::get_color_texture() const {
+	OpenGLTextureGPUData gpu_data = {};
+	gpu_data.id = m_color_texture;
+	if (m_color_texture != 0) {
+		gpu_data.byte_size = static_cast<size_t>(m_settings.size.x) * m_settings.size.y * 4;
+	}
+	return gpu_data;
+}
+
+OpenGLTextureGPUData OpenGLRenderTarget::get_depth_texture() const {
+	OpenGLTextureGPUData gpu_data = {};
+	gpu_data.id = m_depth_texture;
+	if (m_depth_texture != 0) {
+		gpu_data.byte_size = static_cast<size_t>(m_settings.size.x) * m_settings.size.y * 4;
+	}
+	return gpu_data;
+}
+
+bool OpenGLRenderTarget::good() const { return m_complete; }
+
+OpenGLReadback::~OpenGLReadback() {
+	for (auto &buffer : m_pending) {
+		glDeleteSync(buffer.fence);
+		glDeleteBuffers(1, &buffer.buffer);
+	}
+	for (auto &buffer : m_free) {
+		glDeleteBuffers(1, &buffer.buffer);
+	}
+}
+
+void OpenGLReadback::read(const OpenGLRenderTarget &target, const uint64_t tag) {
+	read(target, tag, glm::uvec4(0, 0, target.get_settings().size));
+}
+
+void OpenGLReadback::read(const OpenGLRenderTarget &target, const uint64_t tag, const glm::uvec4 &region) {
+	const auto size = glm::uvec2(region.z, region.w);
+	if (target.get_settings().color_format == 0) {
+		log::error("Render target without a color attachment can not be read back");
+		return;
+	}
+
+	Buffer buffer = {};
+	if (!m_free.empty()) {
+		buffer = m_free.back();
+		m_free.pop_back();
+	}
+	else {
+		// every buffer is still in flight (or taken for the first time), waiting would stall the cpu
+		glGenBuffers(1, &buffer.buffer);
+	}
+	buffer.tag = tag;
+	buffer.size = size;
+
+	const auto byte_size = static_cast<size_t>(size.x) * size.y * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.buffer);
+	if (buffer.capacity < byte_size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, byte_size, NULL, GL_STREAM_READ);
+		buffer.capacity = byte_size;
+	}
+
+	// with a pack buffer bound, glReadPixels writes into it and returns without waiting for the gpu
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, target.get_framebuffer());
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glReadPixels(region.x, region.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// make sure the fence reaches the gpu, polling without flushing could wait forever
+	glFlush();
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_pending.push_back(buffer);
+}
+
+bool OpenGLReadback::poll(Pixels &pixels) { return take(0, pixels); }
+
+bool OpenGLReadback::wait(Pixels &pixels) {
+	if (m_pending.empty()) {
+		return false;
+	}
+	while (!take(1000000000, pixels)) {} // 1 s per try
+	return true;
+}
+
+size_t OpenGLReadback::get_pending_count() const { return m_pending.size(); }
+
+bool OpenGLReadback::take(const GLuint64 timeout, Pixels &pixels) {
+	if (m_pending.empty()) {
+		return false;
+	}
+	auto buffer = m_pending.front();
+	// reads complete in order, so only the oldest one has to be checked
+	const auto status = glClientWaitSync(buffer.fence, 0, timeout);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+		return false;
+	}
+	m_pending.pop_front();
+	glDeleteSync(buffer.fence);
+	buffer.fence = 0;
+
+	const auto byte_size = static_cast<size_t>(buffer.size.x) * buffer.size.y * 4;
+	pixels.tag = buffer.tag;
+	pixels.size = buffer.size;
+	pixels.data.resize(byte_size);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.buffer);
+	const auto *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, byte_size, GL_MAP_READ_BIT);
+	if (data) {
+		std::memcpy(pixels.data.data(), data, byte_size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else {
+		log::error("Mapping a readback buffer failed");
+		std::memset(pixels.data.data(), 0, byte_size);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_free.push_back(buffer);
+	return true;
+}
@@ -0,0 +1,174 @@
+#include "opengl_rendering.h"
+
+#include <cassert>
+
+using namespace ron;
+
+// renders with the camera matrices of a snapshot
+class SnapshotCamera : public ICamera {
+public:
+	SnapshotCamera(const SceneSnapshot &snapshot) : m_snapshot(snapshot) {}
+
+	virtual glm::mat4 get_model_matrix() const override { return m_snapshot.camera_model_matrix; }
+	virtual void set_model_matrix(glm::mat4) override { assert(false); }
+	virtual glm::mat4 get_projection_matrix() const override { return m_snapshot.camera_projection_matrix; }
+private:
+	const SceneSnapshot &m_snapshot;
+};
+
+OpenGLRenderThread::OpenGLRenderThread(GLFWwindow *window, const glm::uvec2 &resolution)
+	: m_window(window) {
+	m_thread = std::thread(&OpenGLRenderThread::run, this, resolution);
+
+	// creating the renderer loads assets, which must not happen on two threads at once
+	std::unique_lock lock(m_mutex);
+	m_frame_rendered.wait(lock, [this] { return m_ready; });
+}
+
+OpenGLRenderThread::~OpenGLRenderThread() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_work_available.notify_one();
+	m_thread.join();
+}
+
+uint64_t OpenGLRenderThread::publish(const Scene &scene, const ICamera &camera) {
+	RON_PROFILE_ZONE("publish snapshot");
+	// the render thread never touches the back snapshot, so it is filled without holding the lock
+	m_snapshot_builder.build(scene, camera, m_back_snapshot);
+	const auto tick = m_back_snapshot.tick;
+	{
+		std::lock_guard lock(m_mutex);
+		// a pending snapshot that was not rendered yet is skipped, its memory is reused next time
+		std::swap(m_back_snapshot, m_pending_snapshot);
+		m_snapshot_pending = true;
+	}
+	m_work_available.notify_one();
+	return tick;
+}
+
+void OpenGLRenderThread::enqueue(std::function<void(OpenGLRenderer &renderer)> function) {
+	{
+		std::lock_guard lock(m_mutex);
+		m_functions.push_back(std::move(function));
+	}
+	m_work_available.notify_one();
+}
+
+void OpenGLRenderThread::wait_until_rendered(const uint64_t tick) {
+	std::unique_lock lock(m_mutex);
+	m_frame_rendered.wait(lock, [this, tick] { return m_rendered_tick >= tick || m_stop; });
+}
+
+uint64_t OpenGLRenderThread::get_rendered_tick() const {
+	std::lock_guard lock(m_mutex);
+	return m_rendered_tick;
+}
+
+void OpenGLRenderThread::run(const glm::uvec2 resolution) {
+	RON_PROFILE_THREAD("render thread");
+	glfwMakeContextCurrent(m_window);
+	m_renderer = std::make_unique<OpenGLRenderer>(resolution);
+	{
+		std::lock_guard lock(m_mutex);
+		m_ready = true;
+	}
+	m_frame_rendered.notify_all();
+
+	auto functions = std::vector<std::function<void(OpenGLRenderer &)>>();
+	while (true) {
+		bool render = false;
+		{
+			std::unique_lock lock(m_mutex);
+			m_work_available.wait(lock, [this] {
+				return m_stop || m_snapshot_pending || !m_functions.empty();
+			});
+			if (m_stop) break;
+
+			std::swap(functions, m_functions);
+			if (m_snapshot_pending) {
+				std::swap(m_pending_snapshot, m_front_snapshot);
+				m_snapshot_pending = false;
+				render = true;
+			}
+		}
+
+		for (const auto &function : functions) { function(*m_renderer); }
+		functions.clear();
+		if (!render) continue;
+
+		apply_snapshot(m_front_snapshot);
+		m_renderer->render(m_scene, SnapshotCamera(m_front_snapshot));
+		glfwSwapBuffers(m_window);
+		RON_PROFILE_FRAME();
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_rendered_tick = m_front_snapshot.tick;
+		}
+		m_frame_rendered.notify_all();
+	}
+
+	// the gpu data has to be released while the context is current
+	m_renderer = nullptr;
+	glfwMakeContextCurrent(NULL);
+	m_frame_rendered.notify_all();
+}
+
+void OpenGLRenderThread::apply_snapshot(const SceneSnapshot &snapshot) {
+	RON_PROFILE_ZONE("apply snapshot");
+	if (snapshot.directional_light_update_count != m_directional_light_update_count) {
+		m_scene.set_directional_light(snapshot.directional_light);
+		m_directional_light_update_count = snapshot.directional_light_update_count;
+	}
+	// includes the uniforms of the directional light
+	m_scene.global_uniforms = snapshot.global_uniforms;
+	m_scene.depth_test = snapshot.depth_test;
+	m_scene.default_material = snapshot.default_material;
+
+	for (const auto &entry : snapshot.mesh_nodes) {
+		if (m_mirrored_mesh_nodes.size() <= entry.id.index) {
+			m_mirrored_mesh_nodes.resize(entry.id.index + 1);
+		}
+		auto &mirrored = m_mirrored_mesh_nodes[entry.id.index];
+		// the slot was reused by another node, or the mesh was copied again because a material changed
+		if (mirrored.mesh_node
+			&& (mirrored.generation != entry.id.generation || mirrored.mesh_node->get_mesh() != entry.mesh)
+		) {
+			m_removed_mesh_nodes.push_back(std::move(mirrored.mesh_node));
+			mirrored.mesh_node = nullptr;
+		}
+
+		if (!mirrored.mesh_node) {
+			mirrored.mesh_node = std::make_shared<MeshNode>(entry.mesh, entry.model_matrix);
+			mirrored.generation = entry.id.generation;
+			m_added_mesh_nodes.push_back(mirrored.mesh_node);
+		}
+		else if (mirrored.mesh_node->get_local_matrix() != entry.model_matrix) {
+			// mirrored nodes are roots, so their local matrix is the model matrix. reading the model
+			// matrix would update the whole hierarchy after every moved node
+			// only moved nodes are reported as changed transforms to the renderer
+			mirrored.mesh_node->set_local_matrix(entry.model_matrix);
+		}
+		mirrored.last_seen_tick = snapshot.tick;
+	}
+
+	// nodes that are not in the snapshot were removed from the scene
+	for (auto &mirrored : m_mirrored_mesh_nodes) {
+		if (mirrored.mesh_node && mirrored.last_seen_tick != snapshot.tick) {
+			m_removed_mesh_nodes.push_back(std::move(mirrored.mesh_node));
+			mirrored.mesh_node = nullptr;
+		}
+	}
+
+	if (!m_removed_mesh_nodes.empty()) {
+		m_scene.remove(m_removed_mesh_nodes);
+		m_removed_mesh_nodes.clear();
+	}
+	if (!m_added_mesh_nodes.empty()) {
+		m_scene.add(m_added_mesh_nodes);
+		m_added_mesh_nodes.clear();
+	}
+}
@@ -2,74 +2,261 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <set>
+
 #include "assets.h"
 #include "log.h"
 
 using namespace ron;
 
+static const std::shared_ptr<Geometry> & get_lod_geometry(
+	const MeshSection &mesh_section, const unsigned int lod_level
+) {
+	return lod_level == 0 ? mesh_section.geometry : mesh_section.lods[lod_level - 1].geometry;
+}
+
+static void set_culling_mode(const Material::CullingMode culling_mode) {
+	switch (culling_mode) {
+		case Material::CullingMode::NONE:
+			glDisable(GL_CULL_FACE); break;
+		case Material::CullingMode::FRONT:
+			glEnable(GL_CULL_FACE); glCullFace(GL_FRONT); break;
+		case Material::CullingMode::BACK:
+			glEnable(GL_CULL_FACE); glCullFace(GL_BACK); break;
+		default: assert(false); break;
+	}
+}
+
+// the upper bits of the product differ even for pointers to neighboring allocations,
+// so truncated pointers still sort equal objects next to each other
+static uint64_t pointer_sort_bits(const void *pointer, const unsigned int bits) {
+	return (reinterpret_cast<uintptr_t>(pointer) * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+// plane (a, b, c, d) -> points with a * x + b * y + c * z + d >= 0 are inside, not normalized
+static std::array<glm::vec4, 6> get_frustum_planes(const glm::mat4 &view_projection_matrix) {
+	const auto rows = glm::transpose(view_projection_matrix);
+	return {
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+}
+
+static bool is_outside_frustum(
+	const std::array<glm::vec4, 6> &frustum_planes, const glm::mat4 &model_matrix, const BoundingSphere &bounds
+) {
+	if (bounds.radius <= 0.0f) {
+		return false; // no bounds
+	}
+	const auto center = glm::vec3(model_matrix * glm::vec4(bounds.center, 1.0f));
+	const auto scale = std::max(
+		std::max(glm::length(glm::vec3(model_matrix[0])), glm::length(glm::vec3(model_matrix[1]))),
+		glm::length(glm::vec3(model_matrix[2]))
+	);
+	for (const auto &plane : frustum_planes) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -bounds.radius * scale * glm::length(glm::vec3(plane))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// values consists of sorted runs, run_offsets holds the begin of every run and the end of the last.
+// neighboring runs are merged in parallel until one sorted run is left
+template <typename T, typename Compare>
+static void merge_sorted_runs(
+	ThreadPool &thread_pool, std::vector<T> &values, std::vector<size_t> &run_offsets, const Compare &compare
+) {
+	while (run_offsets.size() > 2) {
+		const auto pair_count = (run_offsets.size() - 1) / 2;
+		thread_pool.parallel_for(pair_count, [&](const size_t begin, const size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				std::inplace_merge(
+					values.begin() + run_offsets[2 * i], values.begin() + run_offsets[2 * i + 1],
+					values.begin() + run_offsets[2 * i + 2], compare
+				);
+			}
+		});
+		// every second offset is the begin of a merged run, the end has to be kept
+		const auto run_count = run_offsets.size() - 1;
+		size_t count = 0;
+		for (size_t i = 0; i < run_offsets.size(); i += 2) { run_offsets[count++] = run_offsets[i]; }
+		if (run_count % 2 == 1) run_offsets[count++] = run_offsets.back();
+		run_offsets.resize(count);
+	}
+}
+
+// material textures that are left out of a shader program permutation if the material has none,
+// the permutation uses a neutral value instead
+struct TextureFeature {
+	const char *uniform_name;
+	const char *define;
+};
+static const TextureFeature texture_features[] = {
+	{ "albedo_tex", "ALBEDO_TEX" },
+	{ "metallic_roughness_tex", "METALLIC_ROUGHNESS_TEX" },
+	{ "normal_tex", "NORMAL_TEX" },
+};
+static constexpr unsigned int shadows_feature = 1u << std::size(texture_features);
+
+static unsigned int get_texture_features(const Material &material) {
+	unsigned int features = 0;
+	for (size_t i = 0; i < std::size(texture_features); i++) {
+		const auto uniform = material.uniforms.find(texture_features[i].uniform_name);
+		if (uniform == material.uniforms.end() || uniform->second->get_type() != UniformType::TEXTURE) {
+			continue;
+		}
+		const auto &texture = *reinterpret_cast<const std::shared_ptr<Texture> *>(
+			uniform->second->value_ptr()
+		);
+		if (texture) {
+			features |= 1u << i;
+		}
+	}
+	return features;
+}
+
 OpenGLRenderer::OpenGLRenderer(const unsigned int resolution_x, const unsigned int resolution_y)
 	: resolution(resolution_x, resolution_y)
 { init(); }
 
 OpenGLRenderer::OpenGLRenderer(const glm::uvec2 &resolution) : resolution(resolution) { init(); }
 
+OpenGLRenderer::~OpenGLRenderer() {
+	m_shader_programs.for_each([this](const auto &, auto &gpu_data) { m_lifetime_manager.release(gpu_data); });
+	for (auto &[shader_program, gpu_data] : m_compiling_shader_programs) { m_lifetime_manager.release(gpu_data); }
+	m_geometries.for_each([this](const auto &, auto &gpu_data) {
+		if (!gpu_data.evicted) m_lifetime_manager.release(gpu_data);
+	});
+	m_textures.for_each([this](const auto &, auto &gpu_data) {
+		if (!gpu_data.evicted) m_lifetime_manager.release(gpu_data);
+	});
+	for (auto &[dir_light, gpu_data] : m_directional_lights) { m_lifetime_manager.release(gpu_data); }
+	for (auto &[journal_id, state] : m_scene_states) {
+		if (state.transform_buffer.buffer != 0) m_lifetime_manager.release(state.transform_buffer);
+	}
+	m_lifetime_manager.flush();
+}
+
+const OpenGLLifetimeManager & OpenGLRenderer::get_lifetime_manager() const { return m_lifetime_manager; }
+
+const FrameStats & OpenGLRenderer::get_frame_stats() const { return m_last_frame_stats; }
+
+const FrameStatsHistory & OpenGLRenderer::get_frame_stats_history() const { return m_frame_stats_history; }
+
 void OpenGLRenderer::init() {
 	m_error_shader_program = assets::load_shader_program(
 		"default/shaders/error.vert", "default/shaders/error.frag"
 	);
-	if (!m_shader_programs.contains(m_error_shader_program)) {
+	if (!m_shader_programs.contains(*m_error_shader_program)) {
 		auto gpu_data = opengl_setup_shader_program(*m_error_shader_program);
 		assert(gpu_data.id != 0);
-		m_shader_programs.emplace(m_error_shader_program, gpu_data);
+		m_shader_programs.insert(m_error_shader_program, gpu_data);
+		m_lifetime_manager.track(OpenGLLifetimeManager::SHADER_PROGRAM);
 	}
 
 	m_axes_shader_program = assets::load_shader_program(
 		"default/shaders/axes.vert", "default/shaders/axes.frag"
 	);
-	if (!m_shader_programs.contains(m_axes_shader_program)) {
+	if (!m_shader_programs.contains(*m_axes_shader_program)) {
 		auto gpu_data = opengl_setup_shader_program(*m_axes_shader_program);
 		assert(gpu_data.id != 0);
-		m_shader_programs.emplace(m_axes_shader_program, gpu_data);
+		m_shader_programs.insert(m_axes_shader_program, gpu_data);
+		m_lifetime_manager.track(OpenGLLifetimeManager::SHADER_PROGRAM);
 	}
 
 	m_grid_shader_program = assets::load_shader_program(
 		"default/shaders/grid.vert", "default/shaders/grid.frag"
 	);
-	if (!m_shader_programs.contains(m_grid_shader_program)) {
+	if (!m_shader_programs.contains(*m_grid_shader_program)) {
 		auto gpu_data = opengl_setup_shader_program(*m_grid_shader_program);
 		assert(gpu_data.id != 0);
-		m_shader_programs.emplace(m_grid_shader_program, gpu_data);
+		m_shader_programs.insert(m_grid_shader_program, gpu_data);
+		m_lifetime_manager.track(OpenGLLifetimeManager::SHADER_PROGRAM);
 	}
 
 	m_depth_shader_program = assets::load_shader_program(
 		"default/shaders/depth.vert", "default/shaders/depth.frag"
 	);
-	if (!m_shader_programs.contains(m_depth_shader_program)) {
+	if (!m_shader_programs.contains(*m_depth_shader_program)) {
 		auto gpu_data = opengl_setup_shader_program(*m_depth_shader_program);
 		assert(gpu_data.id != 0);
-		m_shader_programs.emplace(m_depth_shader_program, gpu_data);
+		m_shader_programs.insert(m_depth_shader_program, gpu_data);
+		m_lifetime_manager.track(OpenGLLifetimeManager::SHADER_PROGRAM);
 	}
 
+	const auto non_color = Texture::MetaData(Texture::Channels::AUTOMATIC, Texture::ColorSpace::NON_COLOR);
+	const auto white = assets::load_texture("default/textures/white.jpg");
+	const auto non_color_white = assets::load_texture("default/textures/white.jpg", non_color);
+	const auto flat_normal = assets::load_texture("default/textures/normal.png", non_color);
+	m_neutral_textures["albedo_tex"] = make_uniform(white);
+	m_neutral_textures["metallic_roughness_tex"] = make_uniform(non_color_white);
+	m_neutral_textures["normal_tex"] = make_uniform(flat_normal);
+	preload(white);
+	preload(non_color_white);
+	preload(flat_normal);
+
 	// all writes to an srgb image will assume the input is in linear space and will convert to srgb
 	// -> always have this enabled
 	glEnable(GL_FRAMEBUFFER_SRGB);
 }
 
 void OpenGLRenderer::render(const Scene &scene, const ICamera &camera) {
+	render_to(scene, camera, 0, resolution, glm::uvec4(0, 0, resolution));
+}
+
+void OpenGLRenderer::render(const Scene &scene, const ICamera &camera, const OpenGLRenderTarget &target) {
+	const auto &size = target.get_settings().size;
+	render_to(scene, camera, target.get_framebuffer(), size, glm::uvec4(0, 0, size));
+}
+
+void OpenGLRenderer::render(
+	const Scene &scene, const ICamera &camera, const OpenGLRenderTarget &target, const glm::uvec4 &viewport
+) {
+	render_to(scene, camera, target.get_framebuffer(), target.get_settings().size, viewport);
+}
+
+void OpenGLRenderer::render_to(
+	const Scene &scene, const ICamera &camera, const GLuint framebuffer, const glm::uvec2 &size,
+	const glm::uvec4 &viewport
+) {
+	RON_PROFILE_ZONE("OpenGLRenderer::render");
+	const auto render_begin = std::chrono::steady_clock::now();
+	m_gpu_profiler.begin_frame();
 	Uniforms render_cycle_uniforms = {};
 
+	// the world matrices of all mesh nodes are read below, update moved subtrees once
+	scene.update_transforms();
+	auto &scene_state = apply_scene_changes(scene);
+	glBindBufferBase(
+		GL_SHADER_STORAGE_BUFFER, opengl_transform_buffer_binding, scene_state.transform_buffer.buffer
+	);
+
 	const auto camera_world_position = glm::vec3(camera.get_model_matrix()[3]);
 	const auto view_matrix = glm::inverse(camera.get_model_matrix());
 	const auto projection_matrix = camera.get_projection_matrix();
 	const auto view_projection_matrix = projection_matrix * view_matrix;
+	// projection_matrix[1][1] is 1 / tan(fov / 2) -> size in pixels of one unit at distance 1
+	const auto pixels_per_unit_at_unit_distance = projection_matrix[1][1] * viewport.w * 0.5f;
 
-	// render shadow map
+	// prepare the draw commands of both passes on all threads
 	const auto light = scene.get_directional_light();
+	prepare_draw_commands(
+		scene, scene_state, camera_world_position, view_projection_matrix, pixels_per_unit_at_unit_distance,
+		light->shadow.enabled
+	);
+
+	// render shadow map
 	const auto &light_gpu_data = get_dir_light_gpu_data(
 		scene.get_directional_light(), scene.get_directional_light_update_count()
 	);
 	auto light_space_matrix = glm::identity<glm::mat4>();
 	if (light->shadow.enabled) {
+		RON_PROFILE_GPU_ZONE(m_gpu_profiler, "shadow pass");
 		glViewport(0, 0, light->shadow.map_size.x, light->shadow.map_size.y);
 		glBindFramebuffer(GL_FRAMEBUFFER, light_gpu_data.shadow_map_framebuffer);
 			glClear(GL_DEPTH_BUFFER_BIT);
@@ -97,49 +284,49 @@ void OpenGLRenderer::render(const Scene &scene, const ICamera &camera) {
 
 			render_cycle_uniforms["view_projection_matrix"] = make_uniform(light_space_matrix);
 
-			const auto &program_gpu_data = get_shader_program_gpu_data(m_depth_shader_program);
+			const auto program_gpu_data = get_shader_program_gpu_data(m_depth_shader_program);
 			glUseProgram(program_gpu_data.id);
+			m_frame_stats.program_binds++;
 			opengl_set_shader_program_uniforms(program_gpu_data, render_cycle_uniforms);
-
-			for (const auto & mesh_node : scene.get_mesh_nodes()) {
-				const auto model_matrix = mesh_node->get_model_matrix();
-
-				for (const auto & mesh_section : mesh_node->get_mesh()->sections) {
-					const auto &material = mesh_section.material ?
-						mesh_section.material : scene.default_material;
-
-					switch (material->culling_mode) {
-						case Material::CullingMode::NONE:
-							glDisable(GL_CULL_FACE); break;
-						case Material::CullingMode::FRONT:
-							glEnable(GL_CULL_FACE); glCullFace(GL_FRONT); break;
-						case Material::CullingMode::BACK:
-							glEnable(GL_CULL_FACE); glCullFace(GL_BACK); break;
-						default: assert(false); break;
-					}
-
-					Uniforms node_uniforms = {};
-					node_uniforms["model_matrix"] = make_uniform(model_matrix);
-					opengl_set_shader_program_uniforms(program_gpu_data, node_uniforms);
-
-					const auto &geometry_gpu_data = get_geometry_gpu_data(mesh_section.geometry);
-					assert(geometry_gpu_data.vertex_array != 0);
-
-					glDisable(GL_BLEND);
-					glBindVertexArray(geometry_gpu_data.vertex_array);
-					glDrawElements(
-						GL_TRIANGLES, mesh_section.geometry->indices.size(), GL_UNSIGNED_INT, NULL
-					);
-
-					// unbind to avoid accidental modification
-					glBindVertexArray(0);
+			glDisable(GL_BLEND);
+			m_frame_stats.shadow_map_renders++;
+
+			// the commands are sorted by geometry, only the transform changes between most draws
+			int culling_mode = -1; // unknown
+			GLuint vertex_array = 0;
+			for (const auto &command : m_shadow_draw_commands) {
+				if (command.culling_mode != culling_mode) {
+					culling_mode = command.culling_mode;
+					set_culling_mode(command.culling_mode);
 				}
+				set_transform_uniforms(program_gpu_data, *command.mesh_node);
+
+				const auto &geometry_gpu_data = get_geometry_gpu_data(*command.geometry);
+				assert(geometry_gpu_data.vertex_array != 0);
+				if (geometry_gpu_data.vertex_array != vertex_array) {
+					vertex_array = geometry_gpu_data.vertex_array;
+					glBindVertexArray(vertex_array);
+					m_frame_stats.vertex_array_binds++;
+				}
+				glDrawElements(GL_TRIANGLES, geometry_gpu_data.index_count, GL_UNSIGNED_INT, NULL);
+				m_frame_stats.shadow_pass.draw_calls++;
+				m_frame_stats.shadow_pass.instances++;
+				m_frame_stats.shadow_pass.triangles += geometry_gpu_data.index_count / 3;
 			}
+			// unbind to avoid accidental modification
+			glBindVertexArray(0);
 			glUseProgram(0);
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
-	glViewport(0, 0, resolution.x, resolution.y);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+	// the viewport does not limit clearing, the scissor test does
+	const bool partial = viewport != glm::uvec4(0, 0, size);
+	if (partial) {
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(viewport.x, viewport.y, viewport.z, viewport.w);
+	}
 	if (scene.depth_test) {
 		glEnable(GL_DEPTH_TEST);
 	}
@@ -160,64 +347,85 @@ void OpenGLRenderer::render(const Scene &scene, const ICamera &camera) {
 		);
 	}
 
-	for (const auto & mesh_node : scene.get_mesh_nodes()) {
-		const auto model_matrix = mesh_node->get_model_matrix();
-		const auto normal_local_to_world_matrix = mesh_node->get_normal_local_to_world_matrix();
-
-		for (const auto & mesh_section : mesh_node->get_mesh()->sections) {
-			const auto &material = mesh_section.material ?
-				mesh_section.material : scene.default_material;
-
-			switch (material->culling_mode) {
-				case Material::CullingMode::NONE:
-					glDisable(GL_CULL_FACE); break;
-				case Material::CullingMode::FRONT:
-					glEnable(GL_CULL_FACE); glCullFace(GL_FRONT); break;
-				case Material::CullingMode::BACK:
-					glEnable(GL_CULL_FACE); glCullFace(GL_BACK); break;
-				default: assert(false); break;
-			}
-
-			const auto &shader_program = material->shader_program ?
-				material->shader_program : m_error_shader_program;
-
-			const auto &shader_program_gpu_data = get_shader_program_gpu_data(shader_program).id != 0
-				? get_shader_program_gpu_data(shader_program)
-				// if the program is invalid, use the error shader program
-				: get_shader_program_gpu_data(m_error_shader_program);
-
-			glUseProgram(shader_program_gpu_data.id);
-
-			Uniforms node_uniforms = {};
-			node_uniforms["model_matrix"] = make_uniform(model_matrix);
-			node_uniforms["normal_local_to_world_matrix"]
-				= make_uniform(normal_local_to_world_matrix);
-
-			Uniforms all_uniforms = {};
-			all_uniforms.insert(render_cycle_uniforms.begin(), render_cycle_uniforms.end());
-			all_uniforms.insert(scene.global_uniforms.begin(), scene.global_uniforms.end());
-			if (material) {
+	{ // main pass
+		RON_PROFILE_GPU_ZONE(m_gpu_profiler, "main pass");
+		// the commands are sorted by shader program and material, so uniforms are only set when the
+		// material changes. programs keep their uniform values between draws
+		glDisable(GL_BLEND);
+		const Material *material = nullptr;
+		OpenGLShaderProgramGPUData program_gpu_data = {};
+		int culling_mode = -1; // unknown
+		GLuint vertex_array = 0;
+		for (const auto &command : m_draw_commands) {
+			if (command.material != material) {
+				material = command.material;
+				const auto &shader_program = material->shader_program ?
+					get_shader_program_permutation(*material, light->shadow.enabled)
+					: m_error_shader_program;
+				// copied, polling other programs may move the stored gpu data
+				program_gpu_data = get_shader_program_gpu_data(shader_program).id != 0
+					? get_shader_program_gpu_data(shader_program)
+					// if the program is invalid, use the error shader program
+					: get_shader_program_gpu_data(m_error_shader_program);
+				glUseProgram(program_gpu_data.id);
+				m_frame_stats.program_binds++;
+
+				Uniforms all_uniforms = {};
+				all_uniforms.insert(render_cycle_uniforms.begin(), render_cycle_uniforms.end());
+				all_uniforms.insert(scene.global_uniforms.begin(), scene.global_uniforms.end());
 				all_uniforms.insert(material->uniforms.begin(), material->uniforms.end());
-			}
-			all_uniforms.insert(node_uniforms.begin(), node_uniforms.end());
+				if (shader_program == material->shader_program) {
+					// not a permutation, missing textures are sampled anyway
+					all_uniforms.insert(m_neutral_textures.begin(), m_neutral_textures.end());
+				}
+				opengl_set_shader_program_uniforms(program_gpu_data, all_uniforms);
 
-			opengl_set_shader_program_uniforms(shader_program_gpu_data, all_uniforms);
+				if (material->culling_mode != culling_mode) {
+					culling_mode = material->culling_mode;
+					set_culling_mode(material->culling_mode);
+				}
+			}
+			set_transform_uniforms(program_gpu_data, *command.mesh_node);
 
-			const auto &geometry_gpu_data = get_geometry_gpu_data(mesh_section.geometry);
+			const auto &geometry_gpu_data = get_geometry_gpu_data(*command.geometry);
 			assert(geometry_gpu_data.vertex_array != 0);
-
-			glDisable(GL_BLEND);
-			glBindVertexArray(geometry_gpu_data.vertex_array);
-			glDrawElements(GL_TRIANGLES, mesh_section.geometry->indices.size(), GL_UNSIGNED_INT, NULL);
-
-			// unbind to avoid accidental modification
-			glBindVertexArray(0);
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glUseProgram(0);
+			if (geometry_gpu_data.vertex_array != vertex_array) {
+				vertex_array = geometry_gpu_data.vertex_array;
+				glBindVertexArray(vertex_array);
+				m_frame_stats.vertex_array_binds++;
+			}
+			m_frame_stats.main_pass.draw_calls++;
+			m_frame_stats.main_pass.instances++;
+			if (command.range_count != DrawCommand::all_ranges) {
+				// only draw the index ranges of the meshlets that survived culling
+				const auto &ranges = m_draw_lists[command.list_index].visible_ranges;
+				m_multi_draw_counts.clear();
+				m_multi_draw_offsets.clear();
+				for (uint32_t i = command.first_range; i < command.first_range + command.range_count; i++) {
+					m_multi_draw_counts.push_back(ranges[i].count);
+					m_frame_stats.main_pass.triangles += ranges[i].count / 3;
+					m_multi_draw_offsets.push_back(
+						reinterpret_cast<const void *>(ranges[i].offset * sizeof(GLuint))
+					);
+				}
+				glMultiDrawElements(
+					GL_TRIANGLES, m_multi_draw_counts.data(), GL_UNSIGNED_INT,
+					m_multi_draw_offsets.data(), m_multi_draw_counts.size()
+				);
+			}
+			else {
+				glDrawElements(GL_TRIANGLES, geometry_gpu_data.index_count, GL_UNSIGNED_INT, NULL);
+				m_frame_stats.main_pass.triangles += geometry_gpu_data.index_count / 3;
+			}
 		}
+		// unbind to avoid accidental modification
+		glBindVertexArray(0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glUseProgram(0);
 	}
 
 	if (render_axes) {
+		RON_PROFILE_GPU_ZONE(m_gpu_profiler, "axes");
 		const OpenGLShaderProgramGPUData &shader_program_gpu_data
 			= get_shader_program_gpu_data(m_axes_shader_program);
 
@@ -225,14 +433,17 @@ void OpenGLRenderer::render(const Scene &scene, const ICamera &camera) {
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 		glUseProgram(shader_program_gpu_data.id);
+		m_frame_stats.program_binds++;
 		opengl_set_shader_program_uniforms(shader_program_gpu_data, render_cycle_uniforms);
 
 		m_axes_renderer.render();
+		m_frame_stats.main_pass.draw_calls++;
 
 		glUseProgram(0);
 	}
 
 	if (render_grid) {
+		RON_PROFILE_GPU_ZONE(m_gpu_profiler, "grid");
 		const OpenGLShaderProgramGPUData &shader_program_gpu_data
 			= get_shader_program_gpu_data(m_grid_shader_program);
 
@@ -240,12 +451,38 @@ void OpenGLRenderer::render(const Scene &scene, const ICamera &camera) {
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 		glUseProgram(shader_program_gpu_data.id);
+		m_frame_stats.program_binds++;
 		opengl_set_shader_program_uniforms(shader_program_gpu_data, render_cycle_uniforms);
 
 		m_grid_renderer.render();
+		m_frame_stats.main_pass.draw_calls++;
 
 		glUseProgram(0);
 	}
+	if (partial) {
+		glDisable(GL_SCISSOR_TEST);
+	}
+	if (framebuffer != 0) {
+		// rendering into the default framebuffer leaves it bound, so does rendering into a target
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	if (m_release_pending || m_frame_index >= m_last_release_frame + release_interval) {
+		release_unused_gpu_data();
+		m_release_pending = false;
+		m_last_release_frame = m_frame_index;
+	}
+	evict_over_vram_budget();
+	m_gpu_profiler.end_frame();
+	m_lifetime_manager.end_frame();
+	m_frame_index++;
+
+	m_frame_stats.cpu_time = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - render_begin
+	).count();
+	m_last_frame_stats = m_frame_stats;
+	m_frame_stats_history.add(m_frame_stats);
+	m_frame_stats = {};
 }
 
 void OpenGLRenderer::set_clear_color(glm::vec4 clear_color) { m_clear_color = clear_color; }
@@ -282,6 +519,9 @@ void OpenGLRenderer::preload(const Scene &scene) {
 void OpenGLRenderer::preload(const MeshNode &mesh_node) {
 	for (const auto &mesh_section : mesh_node.get_mesh()->sections) {
 		preload(mesh_section.geometry);
+		for (const auto &lod : mesh_section.lods) {
+			preload(lod.geometry);
+		}
 		if (mesh_section.material) {
 			preload(mesh_section.material);
 		}
@@ -290,7 +530,9 @@ void OpenGLRenderer::preload(const MeshNode &mesh_node) {
 
 void OpenGLRenderer::preload(const std::shared_ptr<Material> material) {
 	if (material->shader_program) {
-		preload(material->shader_program);
+		// whether shadows are enabled is only known when rendering, so prepare both
+		preload(get_shader_program_permutation(*material, false));
+		preload(get_shader_program_permutation(*material, true));
 	}
 	for (const auto &[name, uniform] : material->uniforms) {
 		if (uniform->get_type() == UniformType::TEXTURE) {
@@ -302,20 +544,42 @@ void OpenGLRenderer::preload(const std::shared_ptr<Material> material) {
 	}
 }
 
-void OpenGLRenderer::preload(const std::shared_ptr<ShaderProgram> shader_program) {
-	// create gpu data if it does not exist yet
-	if (!m_shader_programs.contains(shader_program)) {
-		auto gpu_data = opengl_setup_shader_program(*shader_program);
-		m_shader_programs.emplace(shader_program, gpu_data);
+void OpenGLRenderer::preload(const std::shared_ptr<ShaderProgram> &shader_program) {
+	// start compiling if gpu data does not exist yet
+	if (!m_shader_programs.contains(*shader_program)
+		&& !m_compiling_shader_programs.contains(shader_program)
+	) {
+		submit_shader_program(shader_program);
 	}
 }
 
-void OpenGLRenderer::preload(const std::shared_ptr<Texture> texture) {
-	// create gpu data if it does not exist yet
-	if (!m_textures.contains(texture)) {
+void OpenGLRenderer::wait_for_shader_programs() {
+	while (!m_compiling_shader_programs.empty()) {
+		poll_shader_program(m_compiling_shader_programs.begin()->first, true);
+	}
+}
+
+void OpenGLRenderer::preload(const std::shared_ptr<Texture> &texture) {
+	// create gpu data if it does not exist yet or was evicted
+	const auto existing = m_textures.find(*texture);
+	if (!existing || existing->evicted) {
+		if (!texture->restore_image_data() && texture->is_released()) {
+			// e.g. a second renderer uploading a texture the first one released
+			log::warn(
+				"Texture " + texture->name + " was released after an upload and can not be uploaded again"
+				+ " (see Residency), it is rendered as an empty texture"
+			);
+		}
 		auto gpu_data = opengl_setup_texture(*texture);
+		gpu_data.last_used_frame = m_frame_index;
+		m_frame_stats.uploaded_bytes += gpu_data.byte_size;
+		// invalid textures are kept with id 0, so they are not set up again every frame
+		// evicted textures keep their slot
+		if (existing) *existing = gpu_data;
+		else m_textures.insert(texture, gpu_data);
+		m_lifetime_manager.track(OpenGLLifetimeManager::TEXTURE);
 		if (gpu_data.id != 0) {
-			m_textures.emplace(texture, gpu_data);
+			texture->release_image_data();
 		}
 	}
 }
@@ -327,21 +591,408 @@ void OpenGLRenderer::preload(
 		auto gpu_data = opengl_setup_dir_light(*dir_light);
 		gpu_data.last_update_count = update_count;
 		m_directional_lights.emplace(dir_light, gpu_data);
+		m_lifetime_manager.track(OpenGLLifetimeManager::DIRECTIONAL_LIGHT);
 	}
 }
 
-void OpenGLRenderer::preload(const std::shared_ptr<Geometry> geometry) {
-	// create gpu data if it does not exist yet
-	if (!m_geometries.contains(geometry)) {
-		m_geometries.emplace(geometry, opengl_setup_geometry(*geometry));
+void OpenGLRenderer::preload(const std::shared_ptr<Geometry> &geometry) {
+	// create gpu data if it does not exist yet or was evicted
+	const auto existing = m_geometries.find(*geometry);
+	if (!existing || existing->evicted) {
+		if (!restore_geometry_data(*geometry)) {
+			log::error("Geometry was released before it was uploaded and can not be restored");
+		}
+		auto gpu_data = opengl_setup_geometry(*geometry);
+		gpu_data.last_used_frame = m_frame_index;
+		m_frame_stats.uploaded_bytes += gpu_data.byte_size;
+		// evicted geometries keep their slot
+		if (existing) *existing = gpu_data;
+		else m_geometries.insert(geometry, gpu_data);
+		m_lifetime_manager.track(OpenGLLifetimeManager::GEOMETRY);
+		release_geometry_data(*geometry);
+	}
+}
+
+void OpenGLRenderer::prepare_draw_commands(
+	const Scene &scene, SceneState &scene_state, const glm::vec3 &camera_world_position,
+	const glm::mat4 &view_projection_matrix, const float pixels_per_unit_at_unit_distance,
+	const bool shadows
+) {
+	RON_PROFILE_ZONE("prepare draw commands");
+	const auto &mesh_nodes = scene.get_mesh_nodes();
+	// small lists, so threads that finish early can take over more of them
+	static const size_t nodes_per_list = 64;
+	const auto list_count = (mesh_nodes.size() + nodes_per_list - 1) / nodes_per_list;
+	if (m_draw_lists.size() < list_count) {
+		m_draw_lists.resize(list_count);
+	}
+	const auto frustum_planes = get_frustum_planes(view_projection_matrix);
+	const auto compare_sort_keys = [](const DrawCommand &a, const DrawCommand &b) { return a.sort_key < b.sort_key; };
+
+	// nothing in here may call OpenGL or change renderer state, every list is only touched by one thread
+	m_thread_pool.parallel_for(list_count, [&](const size_t begin, const size_t end) {
+		RON_PROFILE_ZONE("build draw lists");
+		for (size_t list_index = begin; list_index < end; list_index++) {
+			auto &list = m_draw_lists[list_index];
+			list.draw_commands.clear();
+			list.shadow_draw_commands.clear();
+			list.visible_ranges.clear();
+			list.stats = {};
+
+			const auto nodes_end = std::min(mesh_nodes.size(), (list_index + 1) * nodes_per_list);
+			for (size_t node_index = list_index * nodes_per_list; node_index < nodes_end; node_index++) {
+				auto &mesh_node = *mesh_nodes[node_index];
+				const auto model_matrix = mesh_node.get_model_matrix();
+				const auto &sections = mesh_node.get_mesh()->sections;
+				auto &lod_levels = scene_state.lod_levels[mesh_node.get_scene_id().index];
+				lod_levels.resize(sections.size(), 0);
+				bool drawn = false;
+
+				for (size_t section_index = 0; section_index < sections.size(); section_index++) {
+					const auto &mesh_section = sections[section_index];
+					const auto &material = mesh_section.material
+						? *mesh_section.material : *scene.default_material;
+					const auto lod_level = select_lod(
+						mesh_node, section_index, lod_levels[section_index], camera_world_position,
+						pixels_per_unit_at_unit_distance
+					);
+					lod_levels[section_index] = lod_level;
+
+					if (shadows) {
+						// shadows are less sensitive to detail -> bias towards coarser lods
+						const auto shadow_lod_level = std::min(
+							lod_level + shadow_lod_bias, static_cast<unsigned int>(mesh_section.lods.size())
+						);
+						const auto &geometry = get_lod_geometry(mesh_section, shadow_lod_level);
+						list.shadow_draw_commands.push_back(DrawCommand(
+							pointer_sort_bits(geometry.get(), 62) << 2 | material.culling_mode,
+							&mesh_node, &material, &geometry, material.culling_mode,
+							static_cast<uint32_t>(list_index), 0, DrawCommand::all_ranges
+						));
+					}
+
+					// objects outside of the view may still cast shadows, only the main pass is culled
+					if (frustum_culling && is_outside_frustum(frustum_planes, model_matrix, mesh_section.bounds)) {
+						continue;
+					}
+
+					const auto &geometry = get_lod_geometry(mesh_section, lod_level);
+					auto first_range = static_cast<uint32_t>(list.visible_ranges.size());
+					auto range_count = DrawCommand::all_ranges;
+					if (meshlet_culling && !geometry->meshlets.empty()) {
+						// cull in object space, so the meshlet bounds do not have to be transformed
+						const auto object_space_camera_position
+							= glm::vec3(glm::inverse(model_matrix) * glm::vec4(camera_world_position, 1.0f));
+						// culled into a separate list, ranges of different draws must not be joined
+						list.culled_ranges.clear();
+						cull_meshlets(
+							*geometry, view_projection_matrix * model_matrix, object_space_camera_position,
+							material.culling_mode == Material::CullingMode::BACK, list.culled_ranges
+						);
+						if (list.culled_ranges.empty()) continue;
+						list.visible_ranges.insert(
+							list.visible_ranges.end(), list.culled_ranges.begin(), list.culled_ranges.end()
+						);
+						range_count = static_cast<uint32_t>(list.culled_ranges.size());
+					}
+
+					// sort by program first, switching programs is the most expensive state change
+					const auto sort_key = pointer_sort_bits(material.shader_program.get(), 16) << 48
+						| pointer_sort_bits(&material, 24) << 24
+						| pointer_sort_bits(geometry.get(), 24);
+					list.draw_commands.push_back(DrawCommand(
+						sort_key, &mesh_node, &material, &geometry, material.culling_mode,
+						static_cast<uint32_t>(list_index), first_range, range_count
+					));
+					drawn = true;
+				}
+
+				if (sections.empty()) continue;
+				if (shadows) list.stats.shadow_pass.drawn_nodes++;
+				if (drawn) list.stats.main_pass.drawn_nodes++;
+				else list.stats.main_pass.culled_nodes++;
+			}
+
+			std::sort(list.draw_commands.begin(), list.draw_commands.end(), compare_sort_keys);
+			std::sort(list.shadow_draw_commands.begin(), list.shadow_draw_commands.end(), compare_sort_keys);
+		}
+	});
+
+	for (size_t i = 0; i < list_count; i++) {
+		const auto &stats = m_draw_lists[i].stats;
+		m_frame_stats.shadow_pass.drawn_nodes += stats.shadow_pass.drawn_nodes;
+		m_frame_stats.main_pass.drawn_nodes += stats.main_pass.drawn_nodes;
+		m_frame_stats.main_pass.culled_nodes += stats.main_pass.culled_nodes;
+	}
+
+	// every list is sorted, merge them into one list per pass
+	RON_PROFILE_ZONE("merge draw lists");
+	const auto merge_lists = [&](std::vector<DrawCommand> DrawList::*commands, std::vector<DrawCommand> &merged) {
+		merged.clear();
+		m_sorted_run_offsets.assign(1, 0);
+		for (size_t i = 0; i < list_count; i++) {
+			const auto &list_commands = m_draw_lists[i].*commands;
+			merged.insert(merged.end(), list_commands.begin(), list_commands.end());
+			m_sorted_run_offsets.push_back(merged.size());
+		}
+		merge_sorted_runs(m_thread_pool, merged, m_sorted_run_offsets, compare_sort_keys);
+	};
+	merge_lists(&DrawList::draw_commands, m_draw_commands);
+	merge_lists(&DrawList::shadow_draw_commands, m_shadow_draw_commands);
+}
+
+unsigned int OpenGLRenderer::select_lod(
+	const MeshNode &mesh_node, const size_t section_index, const unsigned int previous_level,
+	const glm::vec3 &camera_world_position, const float pixels_per_unit_at_unit_distance
+) const {
+	const auto &mesh_section = mesh_node.get_mesh()->sections[section_index];
+	const auto lod_count = static_cast<unsigned int>(mesh_section.lods.size());
+	if (lod_count == 0) {
+		return 0;
+	}
+
+	const auto model_matrix = mesh_node.get_model_matrix();
+	const auto world_center = glm::vec3(model_matrix * glm::vec4(mesh_section.bounds.center, 1.0f));
+	// errors are measured in object space, scale them with the largest axis scale
+	const auto scale = std::max(
+		std::max(glm::length(glm::vec3(model_matrix[0])), glm::length(glm::vec3(model_matrix[1]))),
+		glm::length(glm::vec3(model_matrix[2]))
+	);
+	const auto distance = glm::length(world_center - camera_world_position)
+		- mesh_section.bounds.radius * scale;
+	if (distance <= 0.0f) {
+		return 0; // camera is inside the bounds
+	}
+
+	const auto projected_error = [&](const unsigned int level) {
+		if (level == 0) return 0.0f;
+		return mesh_section.lods[level - 1].error * scale / distance * pixels_per_unit_at_unit_distance;
+	};
+
+	// start from the previously selected lod and only switch if the error clearly crosses the
+	// threshold, this avoids flickering between two lods at the transition distance
+	auto level = std::min(previous_level, lod_count);
+	while (level > 0 && projected_error(level) > lod_max_pixel_error * (1.0f + lod_hysteresis)) {
+		level--;
+	}
+	while (level < lod_count && projected_error(level + 1) <= lod_max_pixel_error * (1.0f - lod_hysteresis)) {
+		level++;
+	}
+	return level;
+}
+
+const std::shared_ptr<ShaderProgram> & OpenGLRenderer::get_shader_program_permutation(
+	const Material &material, const bool shadows
+) {
+	const auto &shader_program = material.shader_program;
+	if (!shader_permutations) {
+		return shader_program;
+	}
+
+	const auto features = get_texture_features(material) | (shadows ? shadows_feature : 0);
+	const auto key = std::make_pair(shader_program.get(), features);
+	auto &entry = m_shader_program_permutations[key];
+	// the address may belong to a destroyed program
+	if (entry.shader_program.lock() == shader_program) {
+		return entry.permutation ? entry.permutation : shader_program;
+	}
+	entry.shader_program = shader_program;
+	entry.permutation = nullptr;
+
+	// programs that don't know about permutations are used as they are, instead of compiling
+	// identical copies
+	if (shader_program->get_vertex_shader_source().find("PERMUTATION") == std::string::npos
+		&& shader_program->get_fragment_shader_source().find("PERMUTATION") == std::string::npos
+	) {
+		return shader_program;
+	}
+
+	auto defines = std::set<std::string>{ "PERMUTATION" };
+	for (size_t i = 0; i < std::size(texture_features); i++) {
+		if (features & (1u << i)) defines.insert(texture_features[i].define);
+	}
+	if (shadows) defines.insert("SHADOWS");
+
+	entry.permutation = assets::load_shader_program_variant(shader_program, defines);
+	return entry.permutation;
+}
+
+OpenGLRenderer::SceneState &OpenGLRenderer::apply_scene_changes(const Scene &scene) {
+	RON_PROFILE_ZONE("apply scene changes");
+	const auto &journal = scene.get_journal();
+	const auto [entry, first_time] = m_scene_states.try_emplace(journal.get_id());
+	auto &state = entry->second;
+	state.last_rendered_frame = m_frame_index;
+
+	// new scene, or too many changes since it was rendered last -> look at everything
+	if (first_time || !journal.contains(state.journal_position)) {
+		preload(scene);
+		m_release_pending = true;
+		state.dirty_transforms.clear();
+		state.lod_levels.clear();
+		for (const auto &mesh_node : scene.get_mesh_nodes()) {
+			update_transform(state, *mesh_node);
+		}
+	}
+	else {
+		for (const auto &change : journal.get_since(state.journal_position)) {
+			switch (change.type) {
+				case SceneChange::Type::MESH_NODE_ADDED: {
+					// nullptr if it was removed again in the meantime
+					const auto mesh_node = scene.get_mesh_node(change.mesh_node);
+					if (mesh_node) preload(*mesh_node);
+					// the slot may have belonged to a removed node
+					if (change.mesh_node.index < state.lod_levels.size()) {
+						state.lod_levels[change.mesh_node.index].clear();
+					}
+				} break;
+				case SceneChange::Type::MESH_NODE_REMOVED:
+					m_release_pending = true;
+					break;
+				case SceneChange::Type::TRANSFORM_CHANGED: {
+					const auto mesh_node = scene.get_mesh_node(change.mesh_node);
+					if (mesh_node) update_transform(state, *mesh_node);
+				} break;
+				case SceneChange::Type::MATERIAL_CHANGED:
+					// new textures or shader programs may be used, old ones may be unused now
+					preload(change.material);
+					m_release_pending = true;
+					break;
+				case SceneChange::Type::DIRECTIONAL_LIGHT_CHANGED:
+					// the light gpu data checks the update count of the light
+					break;
+				default: assert(false); break;
+			}
+		}
+	}
+	state.journal_position = journal.get_end();
+	// sized before the draw commands are prepared on several threads
+	state.lod_levels.resize(state.transforms.size());
+
+	// grow the buffer, the old one may still be used by frames in flight
+	if (state.transform_buffer.capacity < state.transforms.size()) {
+		if (state.transform_buffer.buffer != 0) {
+			m_lifetime_manager.release(state.transform_buffer);
+		}
+		state.transform_buffer = opengl_setup_transform_buffer(
+			std::max(state.transforms.size(), state.transforms.size() * 3 / 2)
+		);
+		m_lifetime_manager.track(OpenGLLifetimeManager::TRANSFORM_BUFFER);
+		state.dirty_transforms.clear();
+		for (uint32_t i = 0; i < state.transforms.size(); i++) { state.dirty_transforms.push_back(i); }
+	}
+	m_frame_stats.uploaded_bytes += opengl_upload_transforms(
+		state.transform_buffer, state.transforms, state.dirty_transforms
+	);
+	return state;
+}
+
+void OpenGLRenderer::update_transform(SceneState &scene_state, const MeshNode &mesh_node) {
+	const auto index = mesh_node.get_scene_id().index;
+	if (scene_state.transforms.size() <= index) {
+		scene_state.transforms.resize(index + 1);
+	}
+	scene_state.transforms[index] = opengl_make_transform(
+		mesh_node.get_model_matrix(), mesh_node.get_normal_local_to_world_matrix()
+	);
+	scene_state.dirty_transforms.push_back(index);
+}
+
+void OpenGLRenderer::set_transform_uniforms(
+	const OpenGLShaderProgramGPUData &program_gpu_data, const MeshNode &mesh_node
+) {
+	if (program_gpu_data.transform_index_location != -1) {
+		glUniform1ui(program_gpu_data.transform_index_location, mesh_node.get_scene_id().index);
+		m_frame_stats.uniform_uploads++;
+	}
+	// custom shader programs may still use the matrices directly
+	if (program_gpu_data.model_matrix_location != -1) {
+		glUniformMatrix4fv(
+			program_gpu_data.model_matrix_location, 1, false, glm::value_ptr(mesh_node.get_model_matrix())
+		);
+		m_frame_stats.uniform_uploads++;
+	}
+	if (program_gpu_data.normal_matrix_location != -1) {
+		glUniformMatrix3fv(
+			program_gpu_data.normal_matrix_location, 1, false,
+			glm::value_ptr(mesh_node.get_normal_local_to_world_matrix())
+		);
+		m_frame_stats.uniform_uploads++;
+	}
+}
+
+void OpenGLRenderer::release_unused_gpu_data() {
+	RON_PROFILE_ZONE("release unused gpu data");
+	// the maps hold a reference to their keys, a use count of one means nobody else uses the resource
+	// permutations are owned by their shader program, drop them first
+	std::erase_if(m_shader_program_permutations, [](const auto &entry) {
+		return entry.second.shader_program.expired();
+	});
+	m_shader_programs.erase_if([this](const auto &shader_program, auto &gpu_data) {
+		const auto compiling = m_compiling_shader_programs.find(shader_program);
+		const long references = compiling != m_compiling_shader_programs.end() ? 2 : 1;
+		if (shader_program.use_count() > references) {
+			return false;
+		}
+		if (compiling != m_compiling_shader_programs.end()) {
+			m_lifetime_manager.release(compiling->second);
+			m_compiling_shader_programs.erase(compiling);
+		}
+		m_lifetime_manager.release(gpu_data);
+		return true;
+	});
+	// programs that never finished compiling
+	for (auto it = m_compiling_shader_programs.begin(); it != m_compiling_shader_programs.end();) {
+		if (it->first.use_count() > 1) {
+			++it;
+			continue;
+		}
+		m_lifetime_manager.release(it->second);
+		it = m_compiling_shader_programs.erase(it);
+	}
+
+	const auto release_unused = [this](const auto &resource, auto &gpu_data) {
+		if (resource.use_count() > 1) {
+			return false;
+		}
+		// evicted gpu data was already released
+		if (!gpu_data.evicted) m_lifetime_manager.release(gpu_data);
+		return true;
+	};
+	m_geometries.erase_if(release_unused);
+	m_textures.erase_if(release_unused);
+	for (auto it = m_directional_lights.begin(); it != m_directional_lights.end();) {
+		if (it->first.use_count() > 1) {
+			++it;
+			continue;
+		}
+		m_lifetime_manager.release(it->second);
+		it = m_directional_lights.erase(it);
+	}
+
+	// scenes that were not rendered for a while were probably destroyed
+	for (auto it = m_scene_states.begin(); it != m_scene_states.end();) {
+		if (it->second.last_rendered_frame + release_interval > m_frame_index) {
+			++it;
+			continue;
+		}
+		if (it->second.transform_buffer.buffer != 0) {
+			m_lifetime_manager.release(it->second.transform_buffer);
+		}
+		it = m_scene_states.erase(it);
 	}
 }
 
 const OpenGLShaderProgramGPUData & OpenGLRenderer::get_shader_program_gpu_data(
-	const std::shared_ptr<ShaderProgram> shader_program
+	const std::shared_ptr<ShaderProgram> &shader_program
 ) {
+	// usually nothing is compiling, skip hashing in that case
+	const auto compiling = m_compiling_shader_programs.empty()
+		? m_compiling_shader_programs.end() : m_compiling_shader_programs.find(shader_program);
+	const auto ready = m_shader_programs.find(*shader_program);
+
 	// create shader program if it does not exist yet
-	if (!m_shader_programs.contains(shader_program)) {
+	if (compiling == m_compiling_shader_programs.end() && !ready) {
 		log::warn(
 			std::string("GPU Data of ShaderProgram ")
 			+ shader_program->name + " not found."
@@ -350,50 +1001,155 @@ const OpenGLShaderProgramGPUData & OpenGLRenderer::get_shader_program_gpu_data(
 		preload(shader_program);
 	}
 	else {
-		// check if the shader program was updated, if so, send to gpu again
-		auto &gpu_data = m_shader_programs[shader_program];
-		if (shader_program->get_update_count() > gpu_data.last_update_count) {
-			opengl_release_shader_program(gpu_data);
-			m_shader_programs.erase(shader_program);
-			preload(shader_program);
+		// check if the shader program was updated, if so, compile again
+		const auto &latest_gpu_data = compiling != m_compiling_shader_programs.end()
+			? compiling->second : *ready;
+		if (shader_program->get_update_count() > latest_gpu_data.last_update_count) {
+			submit_shader_program(shader_program);
 		}
 	}
-	return m_shader_programs[shader_program];
+
+	if (!m_compiling_shader_programs.empty() && m_compiling_shader_programs.contains(shader_program)) {
+		poll_shader_program(shader_program, false);
+	}
+
+	// while compiling for the first time there is no program yet -> id 0 -> error shader is used
+	// during hot reloads the previous version is used until the new one is ready
+	static const OpenGLShaderProgramGPUData not_ready = {};
+	const auto result = m_shader_programs.find(*shader_program);
+	return result ? *result : not_ready;
+}
+
+void OpenGLRenderer::submit_shader_program(const std::shared_ptr<ShaderProgram> &shader_program) {
+	// an older version may still be compiling, it is outdated now
+	const auto compiling = m_compiling_shader_programs.find(shader_program);
+	if (compiling != m_compiling_shader_programs.end()) {
+		m_lifetime_manager.release(compiling->second);
+		m_compiling_shader_programs.erase(compiling);
+	}
+
+	m_compiling_shader_programs.emplace(shader_program, opengl_submit_shader_program(*shader_program));
+	m_lifetime_manager.track(OpenGLLifetimeManager::SHADER_PROGRAM);
+	// programs loaded from the cache are ready immediately
+	poll_shader_program(shader_program, false);
+}
+
+bool OpenGLRenderer::poll_shader_program(
+	const std::shared_ptr<ShaderProgram> &shader_program, const bool wait
+) {
+	const auto compiling = m_compiling_shader_programs.find(shader_program);
+	assert(compiling != m_compiling_shader_programs.end());
+
+	auto &gpu_data = compiling->second;
+	if (!opengl_poll_shader_program(gpu_data, shader_program->name, wait)) {
+		return false;
+	}
+
+	// replace the previous version
+	const auto ready = m_shader_programs.find(*shader_program);
+	if (ready) {
+		// the previous version may still be used by frames in flight
+		m_lifetime_manager.release(*ready);
+		*ready = gpu_data;
+	}
+	else {
+		m_shader_programs.insert(shader_program, gpu_data);
+	}
+	m_compiling_shader_programs.erase(compiling);
+	return true;
 }
 
 const OpenGLGeometryGPUData & OpenGLRenderer::get_geometry_gpu_data(
-	const std::shared_ptr<Geometry> geometry
+	const std::shared_ptr<Geometry> &geometry
 ) {
-	if (!m_geometries.contains(geometry)) {
-		log::warn(
-			"GPU Data of Geometry not found."
-			" Consider preloading before rendering."
-		);
+	auto gpu_data = m_geometries.find(*geometry);
+	if (!gpu_data || gpu_data->evicted) {
+		if (!gpu_data) {
+			log::warn(
+				"GPU Data of Geometry not found."
+				" Consider preloading before rendering."
+			);
+		}
 		preload(geometry);
+		gpu_data = m_geometries.find(*geometry);
 	}
-	return m_geometries[geometry];
+	gpu_data->last_used_frame = m_frame_index;
+	return *gpu_data;
 }
 
 const OpenGLTextureGPUData & OpenGLRenderer::get_texture_gpu_data(
-	const std::shared_ptr<Texture> texture
+	const std::shared_ptr<Texture> &texture
 ) {
-	if (!m_textures.contains(texture)) {
+	auto gpu_data = m_textures.find(*texture);
+	if (!gpu_data) {
 		log::warn(
 			std::string("GPU Data of Texture ") + texture->name + " not found."
 			+ " Consider preloading before rendering."
 		);
 		preload(texture);
+		gpu_data = m_textures.find(*texture);
 	}
-	else {
-		// check if the texture was updated, if so, send to gpu again
-		auto &gpu_data = m_textures[texture];
-		if (texture->get_update_count() > gpu_data.last_update_count) {
-			opengl_release_texture(gpu_data);
-			m_textures.erase(texture);
-			preload(texture);
+	else if (gpu_data->evicted) {
+		preload(texture);
+	}
+	else if (texture->get_update_count() > gpu_data->last_update_count) {
+		// the texture was updated, send to gpu again
+		m_lifetime_manager.release(*gpu_data);
+		gpu_data->evicted = true; // released -> preload replaces it
+		preload(texture);
+	}
+
+	gpu_data->last_used_frame = m_frame_index;
+	return *gpu_data;
+}
+
+size_t OpenGLRenderer::get_vram_usage() const {
+	size_t usage = 0;
+	m_geometries.for_each([&](const auto &, const auto &gpu_data) { usage += gpu_data.byte_size; });
+	m_textures.for_each([&](const auto &, const auto &gpu_data) { usage += gpu_data.byte_size; });
+	return usage;
+}
+
+void OpenGLRenderer::evict_over_vram_budget() {
+	if (vram_budget == 0) {
+		return;
+	}
+	auto usage = get_vram_usage();
+	if (usage <= vram_budget) {
+		return;
+	}
+
+	m_eviction_candidates.clear();
+	const auto recently_used = [&](const uint64_t last_used_frame) {
+		return last_used_frame + vram_eviction_grace_frames > m_frame_index;
+	};
+	m_geometries.for_each([&](const auto &geometry, auto &gpu_data) {
+		if (gpu_data.evicted || recently_used(gpu_data.last_used_frame)) return;
+		if (geometry->residency == Residency::RELEASE_AFTER_UPLOAD) return; // can not upload again
+		m_eviction_candidates.push_back(EvictionCandidate(gpu_data.last_used_frame, &gpu_data, nullptr));
+	});
+	m_textures.for_each([&](const auto &texture, auto &gpu_data) {
+		if (gpu_data.evicted || recently_used(gpu_data.last_used_frame)) return;
+		if (texture->residency == Residency::RELEASE_AFTER_UPLOAD) return; // can not upload again
+		m_eviction_candidates.push_back(EvictionCandidate(gpu_data.last_used_frame, nullptr, &gpu_data));
+	});
+	std::sort(m_eviction_candidates.begin(), m_eviction_candidates.end(), [](const auto &a, const auto &b) {
+		return a.last_used_frame < b.last_used_frame;
+	});
+
+	for (const auto &candidate : m_eviction_candidates) {
+		if (usage <= vram_budget) break;
+		if (candidate.geometry) {
+			usage -= candidate.geometry->byte_size;
+			m_lifetime_manager.release(*candidate.geometry);
+			candidate.geometry->evicted = true;
+		}
+		else {
+			usage -= candidate.texture->byte_size;
+			m_lifetime_manager.release(*candidate.texture);
+			candidate.texture->evicted = true;
 		}
 	}
-	return m_textures[texture];
 }
 
 const OpenGLDirectionalLightGPUData & OpenGLRenderer::get_dir_light_gpu_data(
@@ -409,7 +1165,7 @@ const OpenGLDirectionalLightGPUData & OpenGLRenderer::get_dir_light_gpu_data(
 		// check if the light was updated, if so, update gpu data
 		auto &gpu_data = m_directional_lights[dir_light];
 		if (update_count > gpu_data.last_update_count) {
-			opengl_release_dir_light(gpu_data);
+			m_lifetime_manager.release(gpu_data);
 			m_directional_lights.erase(dir_light);
 			preload(dir_light, update_count);
 		}
@@ -436,6 +1192,7 @@ void OpenGLRenderer::opengl_set_shader_program_uniforms(
 				glUniform1i(location, texture_unit_offset);
 				glActiveTexture(GL_TEXTURE0 + texture_unit_offset);
 				glBindTexture(GL_TEXTURE_2D, texture_gpu_data.id);
+				m_frame_stats.texture_binds++;
 				texture_unit_offset++;
 			} break;
 			case GPU_TEXTURE: {
@@ -448,6 +1205,7 @@ void OpenGLRenderer::opengl_set_shader_program_uniforms(
 				glUniform1i(location, texture_unit_offset);
 				glActiveTexture(GL_TEXTURE0 + texture_unit_offset);
 				glBindTexture(GL_TEXTURE_2D, texture_gpu_data.id);
+				m_frame_stats.texture_binds++;
 				texture_unit_offset++;
 			} break;
 			case FLOAT1: {
@@ -541,5 +1299,6 @@ void OpenGLRenderer::opengl_set_shader_program_uniforms(
 
 			default: assert(false); break;
 		}
+		m_frame_stats.uniform_uploads++;
 	}
 }
@@ -5,10 +5,25 @@
 
 #include <glm/glm.hpp>
 
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "scene.h"
+#include "scene_snapshot.h"
 #include "i_camera.h"
+#include "frame_stats.h"
+#include "opengl_resource_table.h"
+#include "profiler.h"
+#include "thread_pool.h"
 
 namespace ron {
 
@@ -19,21 +34,52 @@ struct OpenGLGeometryGPUData {
 	GLuint uvs_buffer = 0;
 	GLuint tangents_buffer = 0;
 	GLuint index_buffer = 0;
+	// the cpu side indices may be released after uploading (see Geometry::residency)
+	GLsizei index_count = 0;
+	size_t byte_size = 0; // size of all buffers
+	uint64_t last_used_frame = 0; // maintained by the renderer
+	bool evicted = false; // released to stay in the vram budget, uploaded again on the next use
 };
 
 struct OpenGLShaderProgramGPUData {
 	GLuint id = 0;
 	unsigned int last_update_count = 0;
+	// only used while the program is being compiled (see opengl_submit_shader_program)
+	bool compiling = false;
+	unsigned int poll_count = 0;
+	GLuint vertex_shader = 0;
+	GLuint fragment_shader = 0;
+	std::string cache_path = "";
+	// per draw uniforms, -1 if the program does not use them. queried after linking
+	GLint transform_index_location = -1;
+	GLint model_matrix_location = -1;
+	GLint normal_matrix_location = -1;
+};
+
+// layout of one transform in the transform buffer (std430, see blinn_phong.vert)
+struct OpenGLTransform {
+	glm::vec4 model_rows[3]; // the last row of a model matrix is always (0, 0, 0, 1)
+	glm::vec4 normal_columns[3]; // vec3 columns are padded to vec4 in std430
+};
+
+// shader storage buffer with the transforms of all mesh nodes of a scene,
+// indexed by the index of the MeshNodeId
+struct OpenGLTransformBufferGPUData {
+	GLuint buffer = 0;
+	size_t capacity = 0; // number of transforms
 };
 
 struct OpenGLTextureGPUData {
 	GLuint id = 0;
 	unsigned int last_update_count = 0;
+	size_t byte_size = 0; // including mipmaps
+	uint64_t last_used_frame = 0; // maintained by the renderer
+	bool evicted = false; // released to stay in the vram budget, uploaded again on the next use
 };
 
 struct OpenGLDirectionalLightGPUData {
-	GLuint shadow_map_framebuffer;
-	GLuint shadow_map;
+	GLuint shadow_map_framebuffer = 0;
+	GLuint shadow_map = 0;
 	unsigned int last_update_count = 0;
 };
 
@@ -72,10 +118,201 @@ private:
 	GLuint m_color_buffer = 0;
 };
 
+// counts the gpu data the renderer holds and deletes the gl objects of released gpu data once the
+// gpu finished all frames that may still use them
+class OpenGLLifetimeManager {
+public:
+	enum ResourceType {
+		GEOMETRY, SHADER_PROGRAM, TEXTURE, DIRECTIONAL_LIGHT, TRANSFORM_BUFFER, RESOURCE_TYPE_COUNT
+	};
+
+	OpenGLLifetimeManager() = default;
+	~OpenGLLifetimeManager(); // calls flush, the OpenGL context must still exist
+	// forbid copying
+	OpenGLLifetimeManager(const OpenGLLifetimeManager&) = delete;
+	OpenGLLifetimeManager &operator=(const OpenGLLifetimeManager&) = delete;
+
+	// call for every gpu data that is created, every tracked gpu data has to be released
+	void track(const ResourceType type);
+	// queue the gl objects of the gpu data for deletion and reset it
+	void release(OpenGLGeometryGPUData &gpu_data);
+	void release(OpenGLShaderProgramGPUData &gpu_data);
+	void release(OpenGLTextureGPUData &gpu_data);
+	void release(OpenGLDirectionalLightGPUData &gpu_data);
+	void release(OpenGLTransformBufferGPUData &gpu_data);
+
+	// call after the commands of a frame were issued. the objects released during the frame are
+	// fenced, objects of earlier frames whose fence was passed by the gpu are deleted
+	void end_frame();
+	// deletes all queued objects without waiting for the gpu, the driver defers the actual deletion
+	void flush();
+
+	// number of tracked gpu data that was not released yet
+	unsigned int get_live_count(const ResourceType type) const;
+	// number of gl objects that are waiting for the gpu
+	size_t get_pending_deletion_count() const;
+private:
+	enum ObjectType { BUFFER, VERTEX_ARRAY, TEXTURE_OBJECT, FRAMEBUFFER, PROGRAM, SHADER };
+	struct Deletion {
+		ObjectType type;
+		GLuint name;
+	};
+	struct FencedDeletions {
+		GLsync fence;
+		std::vector<Deletion> deletions;
+	};
+
+	std::array<unsigned int, RESOURCE_TYPE_COUNT> m_live_counts = {};
+	std::vector<Deletion> m_frame_deletions = {}; // released during the current frame
+	std::deque<FencedDeletions> m_fenced_deletions = {}; // oldest frame first
+
+	void queue(const ObjectType type, const GLuint name);
+	static void delete_objects(const std::vector<Deletion> &deletions);
+};
+
+// measures passes on the gpu with timestamp queries, the results are added to a "GPU" track of the
+// profiler. they are read frame_count frames later, when the gpu is done with them, so reading never
+// waits for the gpu. does nothing unless RON_PROFILING is defined
+class OpenGLGPUProfiler {
+public:
+	OpenGLGPUProfiler() = default;
+	~OpenGLGPUProfiler(); // the OpenGL context must still exist
+	// forbid copying
+	OpenGLGPUProfiler(const OpenGLGPUProfiler&) = delete;
+	OpenGLGPUProfiler &operator=(const OpenGLGPUProfiler&) = delete;
+
+	void begin_frame();
+	void end_frame();
+	// zones may be nested, name has to be a string literal
+	void begin_zone(const char *name);
+	void end_zone();
+
+	class ScopedZone {
+	public:
+		ScopedZone(OpenGLGPUProfiler &gpu_profiler, const char *name) : m_gpu_profiler(gpu_profiler) {
+			m_gpu_profiler.begin_zone(name);
+		}
+		~ScopedZone() { m_gpu_profiler.end_zone(); }
+		// forbid copying
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone &operator=(const ScopedZone&) = delete;
+	private:
+		OpenGLGPUProfiler &m_gpu_profiler;
+	};
+private:
+	struct Query {
+		const char *name;
+		GLuint begin;
+		GLuint end;
+		uint32_t depth;
+	};
+	struct Frame {
+		std::vector<Query> queries = {};
+		int64_t cpu_minus_gpu_time = 0; // converts gpu timestamps to profiler::now
+		bool pending = false; // results were not read yet
+	};
+	static constexpr size_t frame_count = 4;
+
+	std::array<Frame, frame_count> m_frames = {};
+	size_t m_frame = 0;
+	std::vector<GLuint> m_free_queries = {};
+	std::vector<size_t> m_open_zones = {}; // indices into the queries of the current frame
+	profiler::TrackId m_track = UINT32_MAX;
+
+	GLuint get_query();
+	void read_results(Frame &frame);
+};
+
+#ifdef RON_PROFILING
+	// measures the rest of the enclosing scope on the cpu and the gpu
+	#define RON_PROFILE_GPU_ZONE(gpu_profiler, name) \
+		RON_PROFILE_ZONE(name); \
+		const ::ron::OpenGLGPUProfiler::ScopedZone RON_PROFILE_CONCAT(ron_profile_gpu_zone_, __LINE__)( \
+			gpu_profiler, name \
+		)
+#else
+	#define RON_PROFILE_GPU_ZONE(gpu_profiler, name)
+#endif
+
+// an offscreen framebuffer that can be rendered into instead of the default framebuffer
+// (see OpenGLRenderer::render). both attachments are textures, so they can also be sampled
+class OpenGLRenderTarget {
+public:
+	struct Settings {
+		glm::uvec2 size = glm::uvec2(1);
+		GLenum color_format = GL_SRGB8_ALPHA8; // internal format, 0 -> no color attachment
+		GLenum depth_format = GL_DEPTH_COMPONENT24; // internal format, 0 -> no depth attachment
+	};
+
+	OpenGLRenderTarget(const Settings &settings); // the OpenGL context must exist
+	~OpenGLRenderTarget(); // the OpenGL context must still exist
+	// forbid copying
+	OpenGLRenderTarget(const OpenGLRenderTarget&) = delete;
+	OpenGLRenderTarget &operator=(const OpenGLRenderTarget&) = delete;
+
+	const Settings & get_settings() const;
+	GLuint get_framebuffer() const;
+	OpenGLTextureGPUData get_color_texture() const; // e.g. for a GPUTextureUniform
+	OpenGLTextureGPUData get_depth_texture() const;
+	bool good() const; // false if the framebuffer is incomplete
+private:
+	Settings m_settings;
+	GLuint m_framebuffer = 0;
+	GLuint m_color_texture = 0;
+	GLuint m_depth_texture = 0;
+	bool m_complete = false;
+};
+
+// copies the color attachment of render targets into pixel buffer objects and hands the pixels out
+// once the gpu finished them, so reading back never waits for the gpu. with one read per frame the
+// pixels of frame n are usually available while frame n + 2 renders
+class OpenGLReadback {
+public:
+	struct Pixels {
+		uint64_t tag = 0; // passed to read, e.g. a frame index
+		glm::uvec2 size = glm::uvec2(0);
+		std::vector<unsigned char> data = {}; // rgba8, rows from bottom to top like OpenGL
+	};
+
+	OpenGLReadback() = default;
+	~OpenGLReadback(); // the OpenGL context must still exist
+	// forbid copying
+	OpenGLReadback(const OpenGLReadback&) = delete;
+	OpenGLReadback &operator=(const OpenGLReadback&) = delete;
+
+	// queues a copy of the color attachment of target. call after rendering into it, the copy is
+	// ordered after the rendering on the gpu. buffers are reused once their pixels were taken,
+	// while all of them are in flight another one is created
+	void read(const OpenGLRenderTarget &target, const uint64_t tag);
+	// only copies a region (x, y, width, height in pixels from the bottom left corner)
+	void read(const OpenGLRenderTarget &target, const uint64_t tag, const glm::uvec4 &region);
+	// takes the pixels of the oldest read if the gpu finished it, never waits. false -> nothing ready
+	bool poll(Pixels &pixels);
+	// takes the pixels of the oldest read, waits for the gpu if necessary. false -> nothing queued
+	bool wait(Pixels &pixels);
+	size_t get_pending_count() const;
+private:
+	struct Buffer {
+		GLuint buffer = 0;
+		size_t capacity = 0; // bytes
+		GLsync fence = 0;
+		uint64_t tag = 0;
+		glm::uvec2 size = glm::uvec2(0);
+	};
+	std::deque<Buffer> m_pending = {}; // in the order they were read
+	std::vector<Buffer> m_free = {};
+
+	bool take(const GLuint64 timeout, Pixels &pixels);
+};
+
 class OpenGLRenderer {
 public:
 	OpenGLRenderer(const glm::uvec2 &resolution);
 	OpenGLRenderer(const unsigned int resolution_x, const unsigned int resolution_y);
+	~OpenGLRenderer(); // the OpenGL context must still exist
+	// forbid copying
+	OpenGLRenderer(const OpenGLRenderer&) = delete;
+	OpenGLRenderer &operator=(const OpenGLRenderer&) = delete;
 
 	glm::uvec2 resolution;
 
@@ -84,20 +321,61 @@ public:
 	bool render_grid = false;
 	void set_clear_color(glm::vec4 clear_color);
 
+	// level of detail selection, only affects mesh sections with lods (see generate_lods)
+	float lod_max_pixel_error = 1.0f; // coarsest lod whose projected error is below this is used
+	float lod_hysteresis = 0.25f; // relative error margin that has to be crossed to switch lods
+	unsigned int shadow_lod_bias = 1; // the shadow pass uses this many levels coarser lods
+	// geometries with meshlets (see build_meshlets) only draw meshlets that are in the frustum and
+	// not backfacing, only applies to the main pass
+	bool meshlet_culling = true;
+	// mesh sections whose bounds are outside of the view are not drawn in the main pass
+	bool frustum_culling = true;
+	// shader programs that check for PERMUTATION are compiled once per combination of features the
+	// materials and scene use, unused texture samples and shadow code are left out (see blinn_phong)
+	bool shader_permutations = true;
+	// when geometries and textures use more than vram_budget bytes, the least recently used ones are
+	// released and uploaded again when they are used. 0 -> unlimited.
+	// resources used in the last vram_eviction_grace_frames frames are never evicted,
+	// neither are resources whose cpu data can not be restored (see Residency)
+	size_t vram_budget = 0;
+	unsigned int vram_eviction_grace_frames = 2;
+	// unused gpu data is looked for when the scene reports removed nodes or changed materials,
+	// and at least every release_interval frames, to catch resources dropped outside of scenes
+	unsigned int release_interval = 120;
+
 	void preload(const Scene &scene);
 	void preload(const MeshNode &mesh_node);
 	void preload(const std::shared_ptr<Material> material);
-	void preload(const std::shared_ptr<ShaderProgram> shader_program);
-	void preload(const std::shared_ptr<Geometry> geometry);
-	void preload(const std::shared_ptr<Texture> texture);
+	void preload(const std::shared_ptr<ShaderProgram> &shader_program);
+	void preload(const std::shared_ptr<Geometry> &geometry);
+	void preload(const std::shared_ptr<Texture> &texture);
 	void preload(const std::shared_ptr<const DirectionalLight> dir_light, const unsigned int update_count);
+	// shader programs are compiled in the background, until they are ready the error shader program
+	// (or the previous version of the program) is used. this blocks until all are ready.
+	void wait_for_shader_programs();
 
 	void render(const Scene &scene, const ICamera &camera);
+	// renders into target at its size instead of the default framebuffer at resolution.
+	// the aspect ratio of camera should match the size of target
+	void render(const Scene &scene, const ICamera &camera, const OpenGLRenderTarget &target);
+	// renders into a region of target (x, y, width, height in pixels from the bottom left corner),
+	// clearing only affects the region. e.g. to render many small images into one target
+	void render(
+		const Scene &scene, const ICamera &camera, const OpenGLRenderTarget &target, const glm::uvec4 &viewport
+	);
 
 	void clear();
 	void clear_color();
 	void clear_color(glm::vec4 clear_color);
 	void clear_depth();
+
+	// gpu data of resources that are only referenced by the renderer is released after every render
+	const OpenGLLifetimeManager & get_lifetime_manager() const;
+	// bytes used by the gpu data of geometries and textures
+	size_t get_vram_usage() const;
+	// work done by the last render, and of the frames before it
+	const FrameStats & get_frame_stats() const;
+	const FrameStatsHistory & get_frame_stats_history() const;
 private:
 	glm::vec4 m_clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -108,34 +386,221 @@ private:
 	std::shared_ptr<ShaderProgram> m_axes_shader_program = {};
 	std::shared_ptr<ShaderProgram> m_grid_shader_program = {};
 	std::shared_ptr<ShaderProgram> m_depth_shader_program = {};
+	// bound for the textures of the permutation features (see get_shader_program_permutation) that a
+	// material does not have, when its shader program is used without permutations
+	Uniforms m_neutral_textures = {};
 	// OpenGL specific data
-	std::unordered_map<std::shared_ptr<ShaderProgram>, OpenGLShaderProgramGPUData> m_shader_programs = {};
-	std::unordered_map<std::shared_ptr<Geometry>, OpenGLGeometryGPUData> m_geometries = {};
-	std::unordered_map<std::shared_ptr<Texture>, OpenGLTextureGPUData> m_textures = {};
+	// looked up on every draw -> dense tables owned by this renderer (see OpenGLResourceTable)
+	OpenGLResourceTable<ShaderProgram, OpenGLShaderProgramGPUData> m_shader_programs = {};
+	OpenGLResourceTable<Geometry, OpenGLGeometryGPUData> m_geometries = {};
+	OpenGLResourceTable<Texture, OpenGLTextureGPUData> m_textures = {};
+	std::unordered_map<std::shared_ptr<ShaderProgram>, OpenGLShaderProgramGPUData> m_compiling_shader_programs = {};
 	std::unordered_map<std::shared_ptr<const DirectionalLight>, OpenGLDirectionalLightGPUData> m_directional_lights = {};
+	OpenGLLifetimeManager m_lifetime_manager = {};
+	OpenGLGPUProfiler m_gpu_profiler = {};
+	uint64_t m_frame_index = 0;
+	FrameStats m_frame_stats = {}; // counted while rendering, reset after every render
+	FrameStats m_last_frame_stats = {};
+	FrameStatsHistory m_frame_stats_history = {};
+
+	struct SceneState {
+		uint64_t journal_position = 0; // changes before it were applied already (see SceneJournal)
+		uint64_t last_rendered_frame = 0;
+		// indexed by the index of the MeshNodeId, uploaded in ranges when nodes move
+		std::vector<OpenGLTransform> transforms = {};
+		std::vector<uint32_t> dirty_transforms = {};
+		OpenGLTransformBufferGPUData transform_buffer = {};
+		// currently rendered level of detail per mesh section, indexed like transforms
+		// every node is only touched by one thread while preparing draw commands
+		std::vector<std::vector<unsigned int>> lod_levels = {};
+	};
+	// by journal id, states of scenes that are not rendered anymore are released
+	std::unordered_map<uint64_t, SceneState> m_scene_states = {};
+	bool m_release_pending = true;
+	uint64_t m_last_release_frame = 0;
+	// preloads what was added to the scene since it was rendered last and uploads moved transforms
+	SceneState &apply_scene_changes(const Scene &scene);
+	void update_transform(SceneState &scene_state, const MeshNode &mesh_node);
+	// sets the transform index, or the matrices for programs that do not use the transform buffer
+	void set_transform_uniforms(
+		const OpenGLShaderProgramGPUData &program_gpu_data, const MeshNode &mesh_node
+	);
+
+	struct EvictionCandidate {
+		uint64_t last_used_frame;
+		OpenGLGeometryGPUData *geometry; // either geometry or texture is set
+		OpenGLTextureGPUData *texture;
+	};
+	std::vector<EvictionCandidate> m_eviction_candidates = {}; // reused every frame
+
+	// everything needed to replay one draw on the OpenGL thread
+	struct DrawCommand {
+		static constexpr uint32_t all_ranges = UINT32_MAX;
+
+		uint64_t sort_key;
+		const MeshNode *mesh_node;
+		const Material *material;
+		const std::shared_ptr<Geometry> *geometry; // lod that was selected for the pass
+		Material::CullingMode culling_mode;
+		uint32_t list_index; // draw list that holds the visible meshlet ranges
+		uint32_t first_range;
+		uint32_t range_count; // all_ranges -> the whole geometry is drawn
+	};
+	// commands of a chunk of mesh nodes, each list is filled by only one thread
+	struct DrawList {
+		std::vector<DrawCommand> draw_commands;
+		std::vector<DrawCommand> shadow_draw_commands;
+		std::vector<IndexRange> visible_ranges;
+		std::vector<IndexRange> culled_ranges;
+		FrameStats stats; // only the node counts are used
+	};
+	ThreadPool m_thread_pool = {};
+	// reused every frame to avoid allocations
+	std::vector<DrawList> m_draw_lists = {};
+	std::vector<DrawCommand> m_draw_commands = {}; // merged and sorted by sort_key
+	std::vector<DrawCommand> m_shadow_draw_commands = {};
+	std::vector<size_t> m_sorted_run_offsets = {};
+	std::vector<GLsizei> m_multi_draw_counts = {};
+	std::vector<const void *> m_multi_draw_offsets = {};
+
+	struct ShaderProgramPermutation {
+		std::weak_ptr<ShaderProgram> shader_program; // weak, so it can be released when unused
+		std::shared_ptr<ShaderProgram> permutation; // nullptr -> shader_program is used as it is
+	};
+	// key is the material's shader program and the feature bits of the permutation
+	std::map<std::pair<const ShaderProgram *, unsigned int>, ShaderProgramPermutation>
+		m_shader_program_permutations = {};
+	const std::shared_ptr<ShaderProgram> & get_shader_program_permutation(
+		const Material &material, const bool shadows
+	);
 
 	const OpenGLShaderProgramGPUData & get_shader_program_gpu_data(
-		const std::shared_ptr<ShaderProgram> shader_program
+		const std::shared_ptr<ShaderProgram> &shader_program
 	);
-	const OpenGLGeometryGPUData & get_geometry_gpu_data(const std::shared_ptr<Geometry> geometry);
-	const OpenGLTextureGPUData & get_texture_gpu_data(const std::shared_ptr<Texture> texture);
+	void submit_shader_program(const std::shared_ptr<ShaderProgram> &shader_program);
+	bool poll_shader_program(const std::shared_ptr<ShaderProgram> &shader_program, const bool wait);
+	const OpenGLGeometryGPUData & get_geometry_gpu_data(const std::shared_ptr<Geometry> &geometry);
+	const OpenGLTextureGPUData & get_texture_gpu_data(const std::shared_ptr<Texture> &texture);
 	const OpenGLDirectionalLightGPUData & get_dir_light_gpu_data(
 		const std::shared_ptr<const DirectionalLight> dir_light, const unsigned int update_count
 	);
 
+	// selects lods, culls and fills m_draw_commands and m_shadow_draw_commands on the thread pool
+	void prepare_draw_commands(
+		const Scene &scene, SceneState &scene_state, const glm::vec3 &camera_world_position,
+		const glm::mat4 &view_projection_matrix, const float pixels_per_unit_at_unit_distance,
+		const bool shadows
+	);
+	// previous_level is the lod selected in the last frame
+	unsigned int select_lod(
+		const MeshNode &mesh_node, const size_t section_index, const unsigned int previous_level,
+		const glm::vec3 &camera_world_position, const float pixels_per_unit_at_unit_distance
+	) const;
+
+	void release_unused_gpu_data();
+	void evict_over_vram_budget();
+
 	void opengl_set_shader_program_uniforms(
 		const OpenGLShaderProgramGPUData &program_gpu_data, const Uniforms &uniforms
 	);
 
 	void init();
+	// framebuffer 0 is the default framebuffer, rendering is limited to viewport if it is smaller than size
+	void render_to(
+		const Scene &scene, const ICamera &camera, const GLuint framebuffer, const glm::uvec2 &size,
+		const glm::uvec4 &viewport
+	);
+};
+
+// renders on its own thread, so the application can prepare the next frame while the current one is
+// rendered. the application publishes snapshots of its scene, the render thread renders the latest
+// one and skips snapshots that were replaced before it got to them.
+// the OpenGL context of the window is made current on the render thread, it must not be current on
+// any other thread. everything that uses the renderer or the context has to go through enqueue
+class OpenGLRenderThread {
+public:
+	// creates the renderer on the render thread, returns once it is ready
+	OpenGLRenderThread(GLFWwindow *window, const glm::uvec2 &resolution);
+	// functions that were not run yet are dropped, the renderer is destroyed on the render thread
+	~OpenGLRenderThread();
+	// forbid copying
+	OpenGLRenderThread(const OpenGLRenderThread&) = delete;
+	OpenGLRenderThread &operator=(const OpenGLRenderThread&) = delete;
+
+	// takes a snapshot of the scene (see SceneSnapshotBuilder), must be called from one thread only
+	// returns the tick of the snapshot
+	uint64_t publish(const Scene &scene, const ICamera &camera);
+	// runs the function on the render thread before the next frame, e.g. to change renderer settings.
+	// shader programs and textures are read by the render thread, reload them here as well
+	// (see assets::reload_shader_programs)
+	void enqueue(std::function<void(OpenGLRenderer &renderer)> function);
+	// blocks until the snapshot with the tick (or a later one) was rendered and its buffers swapped
+	void wait_until_rendered(const uint64_t tick);
+	// tick of the latest snapshot that was rendered, 0 -> none yet
+	uint64_t get_rendered_tick() const;
+private:
+	GLFWwindow *m_window;
+	SceneSnapshotBuilder m_snapshot_builder = {}; // used by the publishing thread only
+
+	// the publishing thread fills the back snapshot and swaps it with the pending one, the render thread
+	// swaps the pending one with the front one it renders -> neither waits for the other while it works
+	SceneSnapshot m_back_snapshot = {};
+	SceneSnapshot m_pending_snapshot = {};
+	SceneSnapshot m_front_snapshot = {};
+	mutable std::mutex m_mutex = {};
+	std::condition_variable m_work_available = {};
+	std::condition_variable m_frame_rendered = {};
+	bool m_snapshot_pending = false;
+	std::vector<std::function<void(OpenGLRenderer &)>> m_functions = {};
+	uint64_t m_rendered_tick = 0;
+	bool m_ready = false;
+	bool m_stop = false;
+
+	// used by the render thread only
+	// the nodes of the snapshots are mirrored into a scene, so the renderer can track their changes
+	struct MirroredMeshNode {
+		std::shared_ptr<MeshNode> mesh_node = nullptr;
+		uint32_t generation = 0;
+		uint64_t last_seen_tick = 0;
+	};
+	std::unique_ptr<OpenGLRenderer> m_renderer = nullptr;
+	Scene m_scene = Scene(nullptr);
+	std::vector<MirroredMeshNode> m_mirrored_mesh_nodes = {}; // indexed by the index of the MeshNodeId
+	std::vector<std::shared_ptr<MeshNode>> m_added_mesh_nodes = {};
+	std::vector<std::shared_ptr<MeshNode>> m_removed_mesh_nodes = {};
+	unsigned int m_directional_light_update_count = 0;
+
+	std::thread m_thread = {}; // started last, after everything it uses is initialized
+
+	void run(const glm::uvec2 resolution);
+	void apply_snapshot(const SceneSnapshot &snapshot);
 };
 
 OpenGLGeometryGPUData opengl_setup_geometry(const Geometry &geometry);
 void opengl_release_geometry(OpenGLGeometryGPUData &gpu_data);
 
+// compiles and links the shader program, blocks until the driver is done
 OpenGLShaderProgramGPUData opengl_setup_shader_program(const ShaderProgram &shader_program);
+// starts compiling and linking the shader program without waiting for the driver,
+// the returned program may only be used after opengl_poll_shader_program returned true
+OpenGLShaderProgramGPUData opengl_submit_shader_program(const ShaderProgram &shader_program);
+// returns true if compiling and linking is finished (or wait is set). id is 0 if it failed
+bool opengl_poll_shader_program(
+	OpenGLShaderProgramGPUData &gpu_data, const std::string &name, const bool wait = false
+);
 void opengl_release_shader_program(OpenGLShaderProgramGPUData &gpu_data);
 
+// binding point of the transform buffer, layout (std430, binding = 0)
+constexpr GLuint opengl_transform_buffer_binding = 0;
+OpenGLTransform opengl_make_transform(const glm::mat4 &model_matrix, const glm::mat3 &normal_matrix);
+OpenGLTransformBufferGPUData opengl_setup_transform_buffer(const size_t capacity);
+// uploads the transforms at the dirty indices and clears them. nearby indices are merged into
+// ranges, a few larger uploads are cheaper than many small ones. returns the uploaded bytes
+size_t opengl_upload_transforms(
+	const OpenGLTransformBufferGPUData &gpu_data, const std::vector<OpenGLTransform> &transforms,
+	std::vector<uint32_t> &dirty_indices
+);
+
 OpenGLTextureGPUData opengl_setup_texture(const Texture &texture);
 void opengl_release_texture(OpenGLTextureGPUData &gpu_data);
 
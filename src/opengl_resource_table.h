@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ron {
+
+// dense storage of the gpu data of one resource type, owned by one renderer
+// resources are looked up by address, without touching their reference count. nothing is stored in
+// the resources, so they can be shared by several renderers on different threads
+template <typename Resource, typename GPUData>
+class OpenGLResourceTable {
+public:
+	struct Slot {
+		std::shared_ptr<Resource> resource = {}; // nullptr -> slot is free
+		GPUData gpu_data = {};
+	};
+
+	// returns nullptr if the resource has no gpu data in this table
+	GPUData *find(const Resource &resource) {
+		const auto index = m_indices.find(&resource);
+		if (index == m_indices.end()) {
+			return nullptr;
+		}
+		return &m_slots[index->second].gpu_data;
+	}
+
+	bool contains(const Resource &resource) { return find(resource) != nullptr; }
+
+	GPUData &insert(const std::shared_ptr<Resource> &resource, const GPUData &gpu_data) {
+		assert(!contains(*resource));
+		uint32_t index;
+		if (!m_free_slots.empty()) {
+			index = m_free_slots.back();
+			m_free_slots.pop_back();
+		}
+		else {
+			index = static_cast<uint32_t>(m_slots.size());
+			m_slots.emplace_back();
+		}
+
+		auto &slot = m_slots[index];
+		slot.resource = resource;
+		slot.gpu_data = gpu_data;
+		m_indices[resource.get()] = index;
+		return slot.gpu_data;
+	}
+
+	void erase(const Resource &resource) {
+		const auto index = m_indices.find(&resource);
+		if (index != m_indices.end()) {
+			free_slot(index->second);
+		}
+	}
+
+	// calls function(const std::shared_ptr<Resource> &, GPUData &) for every resource
+	template <typename Function>
+	void for_each(const Function &function) {
+		for (auto &slot : m_slots) {
+			if (slot.resource) function(slot.resource, slot.gpu_data);
+		}
+	}
+
+	template <typename Function>
+	void for_each(const Function &function) const {
+		for (const auto &slot : m_slots) {
+			if (slot.resource) function(slot.resource, slot.gpu_data);
+		}
+	}
+
+	// removes every resource for which predicate(const std::shared_ptr<Resource> &, GPUData &)
+	// returns true. the predicate is responsible for releasing the gpu data
+	template <typename Predicate>
+	void erase_if(const Predicate &predicate) {
+		for (uint32_t i = 0; i < m_slots.size(); i++) {
+			if (m_slots[i].resource && predicate(m_slots[i].resource, m_slots[i].gpu_data)) {
+				free_slot(i);
+			}
+		}
+	}
+
+	size_t size() const { return m_indices.size(); }
+private:
+	std::vector<Slot> m_slots = {};
+	std::vector<uint32_t> m_free_slots = {};
+	// slot of every resource
+	std::unordered_map<const Resource *, uint32_t> m_indices = {};
+
+	void free_slot(const uint32_t index) {
+		auto &slot = m_slots[index];
+		m_indices.erase(slot.resource.get());
+		slot.resource = nullptr;
+		slot.gpu_data = {};
+		m_free_slots.push_back(index);
+	}
+};
+
+} // ron
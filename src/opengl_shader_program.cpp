@@ -1,93 +1,287 @@
 #include "opengl_rendering.h"
 
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
 #include "log.h"
 
+#define SHADER_CACHE_DIR _SHADER_CACHE_DIR
+
 using namespace ron;
 
-static GLuint compile_shader(
-	const std::string & source, const GLenum shader_type,
-	GLint *was_successful, GLchar *message, const unsigned int message_size
-) {
+// identifies files written by write_program_binary
+static const char program_binary_magic[4] = { 'R', 'O', 'N', 'B' };
+
+static uint64_t fnv1a_hash(const std::string &data, uint64_t hash = 0xcbf29ce484222325ull) {
+	for (const auto &c : data) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static std::string gl_string(const GLenum name) {
+	const auto string = glGetString(name);
+	return string ? reinterpret_cast<const char *>(string) : "";
+}
+
+// returns the cache file of the shader program or an empty string if caching is not possible
+// the key contains the driver, because binaries are only valid for the driver that created them
+// (defines are part of the sources, so they are covered by the source hash)
+static std::string program_binary_cache_path(const ShaderProgram &shader_program) {
+	static const bool cache_enabled = []() {
+		if (std::string(SHADER_CACHE_DIR).empty()) return false;
+		GLint binary_format_count = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_format_count);
+		return binary_format_count > 0;
+	}();
+	if (!cache_enabled) {
+		return "";
+	}
+
+	auto hash = fnv1a_hash(gl_string(GL_VENDOR));
+	hash = fnv1a_hash(gl_string(GL_RENDERER), hash);
+	hash = fnv1a_hash(gl_string(GL_VERSION), hash);
+	hash = fnv1a_hash(shader_program.get_vertex_shader_source(), hash);
+	hash = fnv1a_hash(std::string(1, '\0'), hash); // separator, so moved code changes the hash
+	hash = fnv1a_hash(shader_program.get_fragment_shader_source(), hash);
+
+	std::stringstream path;
+	path << SHADER_CACHE_DIR << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+	return path.str();
+}
+
+// returns 0 if there is no valid cache entry
+static GLuint read_program_binary(const std::string &path, const ShaderProgram &shader_program) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return 0;
+	}
+
+	// the binary is the rest of the file after the header
+	const auto file_size = static_cast<std::streamoff>(file.tellg());
+	const auto header_size = static_cast<std::streamoff>(sizeof(program_binary_magic) + sizeof(GLenum));
+	char magic[sizeof(program_binary_magic)] = {};
+	GLenum format = 0;
+	std::vector<char> binary(file_size > header_size ? static_cast<size_t>(file_size - header_size) : 0);
+	file.seekg(0);
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char *>(&format), sizeof(format));
+	file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+	if (!file || file.gcount() != static_cast<std::streamsize>(binary.size())
+		|| std::memcmp(magic, program_binary_magic, sizeof(magic)) != 0 || binary.empty()) {
+		log::warn("Ignoring invalid shader cache entry " + path + " (" + shader_program.name + ")");
+		return 0;
+	}
+
+	GLuint program_id = glCreateProgram();
+	glProgramBinary(program_id, format, binary.data(), binary.size());
+
+	GLint linkage_success = false;
+	glGetProgramiv(program_id, GL_LINK_STATUS, &linkage_success);
+	if (!linkage_success) {
+		// this happens e.g. after driver updates, the entry is rewritten after compiling
+		log::warn("Shader cache entry was rejected by the driver (" + shader_program.name + ")");
+		glDeleteProgram(program_id);
+		return 0;
+	}
+
+	return program_id;
+}
+
+static void write_program_binary(const std::string &path, const GLuint program_id) {
+	GLint binary_length = 0;
+	glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+	if (binary_length <= 0) {
+		return;
+	}
+	std::vector<char> binary(binary_length);
+	GLenum format = 0;
+	glGetProgramBinary(program_id, binary_length, nullptr, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+	// write to a temporary file first, so other processes never read half written entries
+	// the name is unique, processes writing the same entry at the same time use different files
+	static thread_local std::mt19937_64 random_engine(std::random_device{}());
+	std::stringstream suffix;
+	suffix << std::hex << random_engine();
+	const auto temporary_path = path + "." + suffix.str() + ".tmp";
+	{
+		std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+		file.write(program_binary_magic, sizeof(program_binary_magic));
+		file.write(reinterpret_cast<const char *>(&format), sizeof(format));
+		file.write(binary.data(), binary.size());
+		if (!file) {
+			log::warn("Failed to write shader cache entry " + path);
+			file.close();
+			std::filesystem::remove(temporary_path, error);
+			return;
+		}
+	}
+	std::filesystem::rename(temporary_path, path, error);
+	if (error) {
+		std::filesystem::remove(temporary_path, error);
+	}
+}
+
+// GL_KHR_parallel_shader_compile is not part of the generated loader
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+static bool parallel_shader_compile_supported() {
+	static const bool supported = []() {
+		GLint extension_count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+		for (GLint i = 0; i < extension_count; i++) {
+			const auto extension = std::string(
+				reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i))
+			);
+			if (extension == "GL_KHR_parallel_shader_compile"
+				|| extension == "GL_ARB_parallel_shader_compile"
+			) {
+				return true;
+			}
+		}
+		return false;
+	}();
+	return supported;
+}
+
+static void query_per_draw_uniform_locations(OpenGLShaderProgramGPUData &gpu_data) {
+	gpu_data.transform_index_location = glGetUniformLocation(gpu_data.id, "transform_index");
+	gpu_data.model_matrix_location = glGetUniformLocation(gpu_data.id, "model_matrix");
+	gpu_data.normal_matrix_location = glGetUniformLocation(gpu_data.id, "normal_local_to_world_matrix");
+}
+
+static GLuint submit_shader(const std::string & source, const GLenum shader_type) {
 	GLuint shader = glCreateShader(shader_type);
 
 	const GLchar* source_c_str = source.c_str();
 	glShaderSource(shader, 1, &source_c_str, NULL);
+	// don't query the status here, that would wait for the compilation to finish
 	glCompileShader(shader);
 
-	glGetShaderiv(shader, GL_COMPILE_STATUS, was_successful);
-	if (!*was_successful) {
-		glGetShaderInfoLog(shader, message_size, NULL, message);
-	}
-
 	return shader;
 }
 
-OpenGLShaderProgramGPUData ron::opengl_setup_shader_program(const ShaderProgram &shader_program) {
-	const unsigned int message_size = 1024;
-	GLchar message[message_size];
+static bool check_shader(const GLuint shader, const std::string &shader_type, const std::string &name) {
+	GLint was_successful = false;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &was_successful);
+	if (!was_successful) {
+		const unsigned int message_size = 1024;
+		GLchar message[message_size];
+		glGetShaderInfoLog(shader, message_size, NULL, message);
 
-	GLint vertex_compilation_success = false;
-	auto vertex_shader = compile_shader(
-		shader_program.get_vertex_shader_source().c_str(), GL_VERTEX_SHADER,
-		&vertex_compilation_success, message, message_size
-	);
-	if (!vertex_compilation_success) {
-		log::error(
-			std::string("Vertex shader compilation failed (")
-			+ shader_program.name + "):" , false
-		);
+		log::error(shader_type + " shader compilation failed (" + name + "):" , false);
 		log::error(message);
 	}
+	return was_successful;
+}
 
-	GLint fragment_compilation_success = false;
-	auto fragment_shader = compile_shader(
-		shader_program.get_fragment_shader_source().c_str(), GL_FRAGMENT_SHADER,
-		&fragment_compilation_success, message, message_size
-	);
-	if (!fragment_compilation_success) {
-		log::error(
-			std::string("Fragment shader compilation failed (")
-			+ shader_program.name + "):" , false
-		);
-		log::error(message);
+OpenGLShaderProgramGPUData ron::opengl_submit_shader_program(const ShaderProgram &shader_program) {
+	RON_PROFILE_ZONE("submit shader program");
+	OpenGLShaderProgramGPUData gpu_data = {};
+	gpu_data.last_update_count = shader_program.get_update_count();
+
+	const auto cache_path = program_binary_cache_path(shader_program);
+	if (!cache_path.empty()) {
+		gpu_data.id = read_program_binary(cache_path, shader_program);
+		if (gpu_data.id != 0) {
+			query_per_draw_uniform_locations(gpu_data);
+			return gpu_data;
+		}
 	}
 
-	// check if compilation failed
-	if (!vertex_compilation_success || !fragment_compilation_success) {
-		glDeleteShader(vertex_shader);
-		glDeleteShader(fragment_shader);
-		return {};
+	gpu_data.vertex_shader = submit_shader(shader_program.get_vertex_shader_source(), GL_VERTEX_SHADER);
+	gpu_data.fragment_shader = submit_shader(
+		shader_program.get_fragment_shader_source(), GL_FRAGMENT_SHADER
+	);
+
+	gpu_data.id = glCreateProgram();
+	glAttachShader(gpu_data.id, gpu_data.vertex_shader);
+	glAttachShader(gpu_data.id, gpu_data.fragment_shader);
+	if (!cache_path.empty()) {
+		glProgramParameteri(gpu_data.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	}
+	// if compilation failed, linking fails as well. the errors are reported when polling
+	glLinkProgram(gpu_data.id);
 
-	GLuint program_id = glCreateProgram();
-	glAttachShader(program_id, vertex_shader);
-	glAttachShader(program_id, fragment_shader);
-	glLinkProgram(program_id);
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
+	gpu_data.compiling = true;
+	gpu_data.cache_path = cache_path;
+	return gpu_data;
+}
 
-	GLint linkage_success;
-	glGetProgramiv(program_id, GL_LINK_STATUS, &linkage_success);
+bool ron::opengl_poll_shader_program(
+	OpenGLShaderProgramGPUData &gpu_data, const std::string &name, const bool wait
+) {
+	if (!gpu_data.compiling) {
+		return true;
+	}
+	if (!wait) {
+		if (parallel_shader_compile_supported()) {
+			GLint completed = GL_FALSE;
+			glGetProgramiv(gpu_data.id, GL_COMPLETION_STATUS_KHR, &completed);
+			if (!completed) return false;
+		}
+		// without the extension any status query blocks until the driver is done.
+		// many drivers still compile in the background, so give them time until the next poll
+		else if (gpu_data.poll_count++ == 0) {
+			return false;
+		}
+	}
 
-	if (!linkage_success) {
+	const bool vertex_success = check_shader(gpu_data.vertex_shader, "Vertex", name);
+	const bool fragment_success = check_shader(gpu_data.fragment_shader, "Fragment", name);
+
+	GLint linkage_success = false;
+	glGetProgramiv(gpu_data.id, GL_LINK_STATUS, &linkage_success);
+	if (!linkage_success && vertex_success && fragment_success) {
 		const unsigned int message_size = 1024;
 		GLchar message[message_size];
-		glGetProgramInfoLog(program_id, message_size, NULL, message);
+		glGetProgramInfoLog(gpu_data.id, message_size, NULL, message);
 
-		log::error(
-			std::string("Linking shader program failed (")
-			+ shader_program.name + "):" , false
-		);
+		log::error(std::string("Linking shader program failed (") + name + "):" , false);
 		log::error(std::string(message));
+	}
 
-		glDeleteProgram(program_id);
-		return {};
+	glDetachShader(gpu_data.id, gpu_data.vertex_shader);
+	glDetachShader(gpu_data.id, gpu_data.fragment_shader);
+	glDeleteShader(gpu_data.vertex_shader);
+	glDeleteShader(gpu_data.fragment_shader);
+	gpu_data.vertex_shader = 0;
+	gpu_data.fragment_shader = 0;
+	gpu_data.compiling = false;
+
+	if (!linkage_success) {
+		glDeleteProgram(gpu_data.id);
+		gpu_data.id = 0;
+		return true;
 	}
 
-	return { program_id, shader_program.get_update_count() };
+	query_per_draw_uniform_locations(gpu_data);
+	if (!gpu_data.cache_path.empty()) {
+		write_program_binary(gpu_data.cache_path, gpu_data.id);
+	}
+	return true;
+}
+
+OpenGLShaderProgramGPUData ron::opengl_setup_shader_program(const ShaderProgram &shader_program) {
+	auto gpu_data = opengl_submit_shader_program(shader_program);
+	opengl_poll_shader_program(gpu_data, shader_program.name, true);
+	return gpu_data;
 }
 
 void ron::opengl_release_shader_program(OpenGLShaderProgramGPUData & gpu_data) {
+	// shaders only exist while the program is still compiling
+	glDeleteShader(gpu_data.vertex_shader);
+	glDeleteShader(gpu_data.fragment_shader);
 	glDeleteProgram(gpu_data.id);
 	gpu_data = {};
 }
@@ -5,7 +5,8 @@
 using namespace ron;
 
 OpenGLTextureGPUData ron::opengl_setup_texture(const Texture &texture) {
-	if (!texture.good()) {
+	RON_PROFILE_ZONE("upload texture");
+	if (!texture.has_image_data()) {
 		return {};
 	}
 	OpenGLTextureGPUData gpu_data;
@@ -93,13 +94,17 @@ OpenGLTextureGPUData ron::opengl_setup_texture(const Texture &texture) {
 	// unbind buffer to avoid accidental modification
 	glBindTexture(GL_TEXTURE_2D, 0);
 
+	// one byte per channel, the mipmap chain adds a third
+	gpu_data.byte_size = static_cast<size_t>(texture.image_data.width) * texture.image_data.height
+		* texture.image_data.n_channels * 4 / 3;
+
 	gpu_data.last_update_count = texture.get_update_count();
 	return gpu_data;
 }
 
 void ron::opengl_release_texture(OpenGLTextureGPUData &gpu_data) {
 	if (gpu_data.id != 0) {
-		glDeleteTextures(0, &gpu_data.id);
+		glDeleteTextures(1, &gpu_data.id);
 		gpu_data.id = 0;
 	}
 }
@@ -0,0 +1,60 @@
+#include "opengl_rendering.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace ron;
+
+OpenGLTransform ron::opengl_make_transform(const glm::mat4 &model_matrix, const glm::mat3 &normal_matrix) {
+	const auto rows = glm::transpose(model_matrix);
+	OpenGLTransform transform = {};
+	for (int i = 0; i < 3; i++) {
+		transform.model_rows[i] = rows[i];
+		transform.normal_columns[i] = glm::vec4(normal_matrix[i], 0.0f);
+	}
+	return transform;
+}
+
+OpenGLTransformBufferGPUData ron::opengl_setup_transform_buffer(const size_t capacity) {
+	OpenGLTransformBufferGPUData gpu_data = {};
+	gpu_data.capacity = capacity;
+
+	glGenBuffers(1, &gpu_data.buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu_data.buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(OpenGLTransform), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	return gpu_data;
+}
+
+size_t ron::opengl_upload_transforms(
+	const OpenGLTransformBufferGPUData &gpu_data, const std::vector<OpenGLTransform> &transforms,
+	std::vector<uint32_t> &dirty_indices
+) {
+	RON_PROFILE_ZONE("upload transforms");
+	if (dirty_indices.empty()) return 0;
+	// up to this many clean transforms between two dirty ones are uploaded as well
+	static const uint32_t max_gap = 8;
+
+	std::sort(dirty_indices.begin(), dirty_indices.end());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu_data.buffer);
+	size_t uploaded_bytes = 0;
+	size_t i = 0;
+	while (i < dirty_indices.size()) {
+		const auto begin = dirty_indices[i];
+		auto end = begin + 1;
+		// indices may be dirty more than once
+		while (++i < dirty_indices.size() && dirty_indices[i] <= end + max_gap) {
+			end = std::max(end, dirty_indices[i] + 1);
+		}
+		assert(end <= gpu_data.capacity && end <= transforms.size());
+		glBufferSubData(
+			GL_SHADER_STORAGE_BUFFER, begin * sizeof(OpenGLTransform),
+			(end - begin) * sizeof(OpenGLTransform), transforms.data() + begin
+		);
+		uploaded_bytes += (end - begin) * sizeof(OpenGLTransform);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	dirty_indices.clear();
+	return uploaded_bytes;
+}
@@ -0,0 +1,195 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#include "log.h"
+
+using namespace ron;
+
+struct ProfilerOpenZone {
+	const char *name;
+	int64_t begin;
+};
+
+struct ProfilerTrack {
+	std::string name;
+	// zones are added by the thread of the track and read when frames end and traces are written
+	std::mutex mutex = {};
+	std::deque<profiler::Zone> zones = {}; // ordered by end
+	std::vector<ProfilerOpenZone> open_zones = {}; // only used by the thread of the track
+};
+
+struct ProfilerFrameEnd {
+	uint64_t frame;
+	int64_t time;
+};
+
+// tracks are never destroyed, so zones of threads that exited can still be written
+static std::mutex tracks_mutex;
+static std::vector<std::unique_ptr<ProfilerTrack>> tracks = {};
+static std::deque<ProfilerFrameEnd> frame_ends = {}; // guarded by tracks_mutex
+static std::atomic<uint64_t> frame_index = 0;
+static std::atomic<uint64_t> frame_capacity = 300;
+
+static thread_local profiler::TrackId thread_track = UINT32_MAX;
+static thread_local ProfilerTrack *thread_track_data = nullptr; // zones are recorded without a global lock
+
+static ProfilerTrack &get_track(const profiler::TrackId track) {
+	std::lock_guard lock(tracks_mutex);
+	return *tracks[track];
+}
+
+int64_t profiler::now() {
+	// relative to the first call, so the timestamps in traces stay small
+	static const auto start = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start
+	).count();
+}
+
+static ProfilerTrack &get_thread_track_data() {
+	if (!thread_track_data) profiler::get_thread_track();
+	return *thread_track_data;
+}
+
+void profiler::begin_zone(const char *name) {
+	auto &track = get_thread_track_data();
+	track.open_zones.push_back(ProfilerOpenZone(name, now()));
+}
+
+void profiler::end_zone() {
+	const auto end = now();
+	auto &track = get_thread_track_data();
+	assert(!track.open_zones.empty());
+	const auto open_zone = track.open_zones.back();
+	track.open_zones.pop_back();
+
+	std::lock_guard lock(track.mutex);
+	track.zones.push_back(Zone(
+		open_zone.name, open_zone.begin, end, frame_index, thread_track,
+		static_cast<uint32_t>(track.open_zones.size())
+	));
+}
+
+void profiler::add_zone(
+	const TrackId track_id, const char *name, const int64_t begin, const int64_t end, const uint32_t depth
+) {
+	auto &track = get_track(track_id);
+	std::lock_guard lock(track.mutex);
+	track.zones.push_back(Zone(name, begin, end, frame_index, track_id, depth));
+}
+
+profiler::TrackId profiler::get_thread_track() {
+	if (thread_track == UINT32_MAX) {
+		std::lock_guard lock(tracks_mutex);
+		thread_track = static_cast<TrackId>(tracks.size());
+		tracks.push_back(std::make_unique<ProfilerTrack>("thread " + std::to_string(thread_track)));
+		thread_track_data = tracks.back().get();
+	}
+	return thread_track;
+}
+
+void profiler::set_thread_name(const std::string &name) {
+	auto &track = get_thread_track_data();
+	std::lock_guard lock(track.mutex);
+	track.name = name;
+}
+
+profiler::TrackId profiler::create_track(const std::string &name) {
+	std::lock_guard lock(tracks_mutex);
+	tracks.push_back(std::make_unique<ProfilerTrack>(name));
+	return static_cast<TrackId>(tracks.size() - 1);
+}
+
+void profiler::set_frame_capacity(const uint64_t capacity) { frame_capacity = std::max<uint64_t>(capacity, 1); }
+
+void profiler::end_frame() {
+	const auto time = now();
+	const auto frame = frame_index++;
+	// zones of frames before first_kept_frame are dropped
+	const auto first_kept_frame = frame + 1 >= frame_capacity ? frame + 1 - frame_capacity : 0;
+
+	std::lock_guard lock(tracks_mutex);
+	frame_ends.push_back(ProfilerFrameEnd(frame, time));
+	while (frame_ends.front().frame < first_kept_frame) { frame_ends.pop_front(); }
+	for (const auto &track : tracks) {
+		std::lock_guard track_lock(track->mutex);
+		while (!track->zones.empty() && track->zones.front().frame < first_kept_frame) {
+			track->zones.pop_front();
+		}
+	}
+}
+
+uint64_t profiler::get_frame_index() { return frame_index; }
+
+void profiler::get_zones(std::vector<Zone> &zones, const uint64_t first_frame) {
+	std::lock_guard lock(tracks_mutex);
+	for (const auto &track : tracks) {
+		std::lock_guard track_lock(track->mutex);
+		for (const auto &zone : track->zones) {
+			if (zone.frame >= first_frame) zones.push_back(zone);
+		}
+	}
+}
+
+static std::string escape_json(const std::string &text) {
+	std::string escaped = {};
+	escaped.reserve(text.size());
+	for (const auto c : text) {
+		if (c == '"' || c == '\\') escaped += '\\';
+		escaped += c;
+	}
+	return escaped;
+}
+
+bool profiler::write_chrome_trace(const std::string &path) {
+	auto file = std::ofstream(path);
+	if (!file) {
+		log::error("Writing the trace failed, could not open " + path);
+		return false;
+	}
+
+	// timestamps are microseconds
+	file << "{\"traceEvents\":[\n";
+	file << std::fixed;
+	file.precision(3);
+	bool first = true;
+	const auto separator = [&first, &file]() {
+		if (!first) file << ",\n";
+		first = false;
+	};
+
+	std::lock_guard lock(tracks_mutex);
+	for (size_t i = 0; i < tracks.size(); i++) {
+		std::lock_guard track_lock(tracks[i]->mutex);
+		separator();
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"" << escape_json(tracks[i]->name) << "\"}}";
+		for (const auto &zone : tracks[i]->zones) {
+			separator();
+			file << "{\"name\":\"" << escape_json(zone.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << i
+				<< ",\"ts\":" << static_cast<double>(zone.begin) / 1000.0
+				<< ",\"dur\":" << static_cast<double>(zone.end - zone.begin) / 1000.0
+				<< ",\"args\":{\"frame\":" << zone.frame << "}}";
+		}
+	}
+	for (const auto &frame_end : frame_ends) {
+		separator();
+		file << "{\"name\":\"frame " << frame_end.frame << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0"
+			<< ",\"ts\":" << static_cast<double>(frame_end.time) / 1000.0 << "}";
+	}
+	file << "\n]}\n";
+
+	if (!file) {
+		log::error("Writing the trace failed (" + path + ")");
+		return false;
+	}
+	return true;
+}
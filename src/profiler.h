@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// zones are only recorded when RON_PROFILING is defined (cmake option RON_PROFILING),
+// otherwise the macros expand to nothing
+#ifdef RON_PROFILING
+	#define RON_PROFILE_CONCAT_INNER(a, b) a##b
+	#define RON_PROFILE_CONCAT(a, b) RON_PROFILE_CONCAT_INNER(a, b)
+	// measures the rest of the enclosing scope, name has to be a string literal
+	#define RON_PROFILE_ZONE(name) \
+		const ::ron::profiler::ScopedZone RON_PROFILE_CONCAT(ron_profile_zone_, __LINE__)(name)
+	// names the track of the calling thread in the trace
+	#define RON_PROFILE_THREAD(name) ::ron::profiler::set_thread_name(name)
+	#define RON_PROFILE_FRAME() ::ron::profiler::end_frame()
+#else
+	#define RON_PROFILE_ZONE(name)
+	#define RON_PROFILE_THREAD(name)
+	#define RON_PROFILE_FRAME()
+#endif
+
+namespace ron::profiler {
+
+// every thread that records zones gets a track, gpu timings are recorded on tracks of their own
+using TrackId = uint32_t;
+
+struct Zone {
+	const char *name;
+	int64_t begin; // nanoseconds, see now
+	int64_t end;
+	uint64_t frame; // frame the zone ended in
+	TrackId track;
+	uint32_t depth; // number of enclosing zones on the same track
+};
+
+// nanoseconds on a monotonic clock
+int64_t now();
+
+// zones must be ended on the thread that began them, in reverse order
+void begin_zone(const char *name);
+void end_zone();
+// records a zone that was measured elsewhere, e.g. on the gpu (see OpenGLGPUProfiler)
+void add_zone(const TrackId track, const char *name, const int64_t begin, const int64_t end, const uint32_t depth);
+
+TrackId get_thread_track();
+void set_thread_name(const std::string &name);
+// a track that is not bound to a thread
+TrackId create_track(const std::string &name);
+
+// zones of the last frame_capacity frames are kept, older ones are dropped when a frame ends
+void set_frame_capacity(const uint64_t frame_capacity);
+// ends the current frame, call once per frame (OpenGLRenderThread does it for the frames it renders)
+void end_frame();
+uint64_t get_frame_index();
+
+// appends the kept zones that ended in frame first_frame or later, ordered by track and end
+void get_zones(std::vector<Zone> &zones, const uint64_t first_frame = 0);
+// Chrome trace event format, can be opened in chrome://tracing and ui.perfetto.dev
+bool write_chrome_trace(const std::string &path);
+
+class ScopedZone {
+public:
+	ScopedZone(const char *name) { begin_zone(name); }
+	~ScopedZone() { end_zone(); }
+	// forbid copying
+	ScopedZone(const ScopedZone&) = delete;
+	ScopedZone &operator=(const ScopedZone&) = delete;
+};
+
+} // ron::profiler
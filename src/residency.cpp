@@ -0,0 +1,104 @@
+#include "residency.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include "log.h"
+#include "meshes.h"
+
+using namespace ron;
+
+std::shared_ptr<const std::string> ron::create_cooked_cache_path(const std::string &prefix) {
+	// multiple processes may share the temporary directory -> include a random number per process
+	static const auto process_token = std::random_device()();
+	static std::atomic<uint64_t> counter = 0;
+	const auto file_name = "ron_" + prefix + "_" + std::to_string(process_token)
+		+ "_" + std::to_string(counter++) + ".bin";
+	const auto path = (std::filesystem::temp_directory_path() / file_name).string();
+
+	return std::shared_ptr<const std::string>(new std::string(path), [](const std::string *path) {
+		std::error_code error; // ignore errors, the file may never have been written
+		std::filesystem::remove(*path, error);
+		delete path;
+	});
+}
+
+template <typename T>
+static void write_vector(std::ofstream &file, const std::vector<T> &vector) {
+	const uint64_t size = vector.size();
+	file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+	file.write(reinterpret_cast<const char *>(vector.data()), size * sizeof(T));
+}
+
+template <typename T>
+static void read_vector(std::ifstream &file, std::vector<T> &vector) {
+	uint64_t size = 0;
+	file.read(reinterpret_cast<char *>(&size), sizeof(size));
+	if (!file) return;
+	vector.resize(size);
+	file.read(reinterpret_cast<char *>(vector.data()), size * sizeof(T));
+}
+
+// swapping with an empty vector frees the memory, clear would keep the capacity
+template <typename T>
+static void free_vector(std::vector<T> &vector) { std::vector<T>().swap(vector); }
+
+void ron::release_geometry_data(Geometry &geometry) {
+	if (geometry.residency == Residency::KEEP || geometry.released) {
+		return;
+	}
+
+	if (geometry.residency == Residency::RELOAD_FROM_SOURCE_ON_DEMAND) {
+		geometry.cooked_cache_path = create_cooked_cache_path("geometry");
+		std::ofstream file(*geometry.cooked_cache_path, std::ios::binary);
+		write_vector(file, geometry.positions);
+		write_vector(file, geometry.normals);
+		write_vector(file, geometry.uvs);
+		write_vector(file, geometry.tangents);
+		write_vector(file, geometry.indices);
+		if (!file) {
+			log::warn("Could not write cooked cache of geometry, keeping it in memory");
+			geometry.cooked_cache_path = nullptr;
+			return;
+		}
+	}
+
+	free_vector(geometry.positions);
+	free_vector(geometry.normals);
+	free_vector(geometry.uvs);
+	free_vector(geometry.tangents);
+	free_vector(geometry.indices);
+	geometry.released = true;
+}
+
+bool ron::restore_geometry_data(Geometry &geometry) {
+	if (!geometry.released) {
+		return true;
+	}
+	if (!geometry.cooked_cache_path) {
+		return false; // released with RELEASE_AFTER_UPLOAD
+	}
+
+	std::ifstream file(*geometry.cooked_cache_path, std::ios::binary);
+	read_vector(file, geometry.positions);
+	read_vector(file, geometry.normals);
+	read_vector(file, geometry.uvs);
+	read_vector(file, geometry.tangents);
+	read_vector(file, geometry.indices);
+	if (!file) {
+		log::error("Failed to restore released geometry from " + *geometry.cooked_cache_path);
+		free_vector(geometry.positions);
+		free_vector(geometry.normals);
+		free_vector(geometry.uvs);
+		free_vector(geometry.tangents);
+		free_vector(geometry.indices);
+		return false;
+	}
+
+	geometry.released = false;
+	geometry.cooked_cache_path = nullptr;
+	return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace ron {
+
+// what happens with the cpu side data of a geometry or texture after it was uploaded to the gpu
+enum class Residency {
+	KEEP, // the data stays in memory
+	RELEASE_AFTER_UPLOAD, // the data is freed and can not be restored
+	// the data is freed and loaded again when it is needed (e.g. to upload it again), either from
+	// its source file or from a cooked cache file that is written when it is released
+	RELOAD_FROM_SOURCE_ON_DEMAND
+};
+
+// returns a new unique path in the temporary directory
+// the file at the path is deleted when the last copy of the returned pointer is destroyed
+std::shared_ptr<const std::string> create_cooked_cache_path(const std::string &prefix);
+
+} // ron
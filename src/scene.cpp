@@ -1,8 +1,9 @@
 #include "scene.h"
 
-#include <algorithm>
+#include <unordered_map>
 
 #include "assets.h"
+#include "log.h"
 
 using namespace ron;
 
@@ -17,17 +18,7 @@ Scene::Scene() : default_material(std::make_shared<Material>()) {
 	default_material->shader_program = assets::load_shader_program(
 		"default/shaders/blinn_phong.vert", "default/shaders/blinn_phong.frag"
 	);
-	default_material->uniforms["albedo_tex"] = ron::make_uniform(
-		assets::load_texture("default/textures/white.jpg")
-	);
-	default_material->uniforms["normal_tex"] = ron::make_uniform(assets::load_texture(
-		"default/textures/normal.png",
-		Texture::MetaData(Texture::Channels::AUTOMATIC, Texture::ColorSpace::NON_COLOR)
-	));
-	default_material->uniforms["metallic_roughness_tex"] = ron::make_uniform(assets::load_texture(
-		"default/textures/white.jpg",
-		Texture::MetaData(Texture::Channels::AUTOMATIC, Texture::ColorSpace::NON_COLOR)
-	));
+	// without textures, the renderer uses neutral values for them
 	default_material->uniforms["albedo_color"] = make_uniform(glm::vec4(1.0, 1.0, 1.0, 1.0));
 	default_material->uniforms["metallic_factor"] = make_uniform(glm::vec1(0.0));
 	default_material->uniforms["roughness_factor"] = make_uniform(glm::vec1(0.5));
@@ -40,28 +31,196 @@ Scene::Scene(std::shared_ptr<Material> default_mat) : default_material(default_m
 
 const std::vector<std::shared_ptr<MeshNode>> & Scene::get_mesh_nodes() const { return m_mesh_nodes; }
 
-void Scene::add(const std::shared_ptr<MeshNode> node) {
+std::shared_ptr<MeshNode> Scene::get_mesh_node(const MeshNodeId id) const {
+	if (!contains(id)) return nullptr;
+	return m_mesh_nodes[m_mesh_node_slots[id.index].dense_index];
+}
+
+bool Scene::contains(const MeshNodeId id) const {
+	return id.index < m_mesh_node_slots.size()
+		&& m_mesh_node_slots[id.index].dense_index != MeshNodeId::invalid_index
+		&& m_mesh_node_slots[id.index].generation == id.generation;
+}
+
+MeshNodeId Scene::add(const std::shared_ptr<MeshNode> &node, const TransformHierarchy::Id parent) {
+	if (node->m_transforms == m_transforms) {
+		log::warn("MeshNode is already part of the scene");
+		return node->m_scene_id;
+	}
+	if (node->m_transforms) {
+		log::warn("MeshNode is part of another scene and is not added, remove it from that scene first");
+		return MeshNodeId();
+	}
+	return insert(node, m_transforms->create(node->get_model_matrix(), parent));
+}
+
+MeshNodeId Scene::insert(const std::shared_ptr<MeshNode> &node, const TransformHierarchy::Id transform_id) {
+	node->m_transform_id = transform_id;
+	node->m_transforms = m_transforms;
+
+	uint32_t slot_index;
+	if (!m_free_mesh_node_slots.empty()) {
+		slot_index = m_free_mesh_node_slots.back();
+		m_free_mesh_node_slots.pop_back();
+	}
+	else {
+		slot_index = static_cast<uint32_t>(m_mesh_node_slots.size());
+		m_mesh_node_slots.emplace_back();
+	}
+	auto &slot = m_mesh_node_slots[slot_index];
+	slot.dense_index = static_cast<uint32_t>(m_mesh_nodes.size());
 	m_mesh_nodes.push_back(node);
+	m_mesh_node_slot_indices.push_back(slot_index);
+
+	node->m_scene_id = MeshNodeId(slot_index, slot.generation);
+	if (m_transform_mesh_nodes.size() <= transform_id) {
+		m_transform_mesh_nodes.resize(transform_id + 1);
+	}
+	m_transform_mesh_nodes[transform_id] = node->m_scene_id;
+	m_journal.record(SceneChange(SceneChange::Type::MESH_NODE_ADDED, node->m_scene_id));
+	return node->m_scene_id;
 }
 
-void Scene::add(std::vector<std::shared_ptr<MeshNode>> nodes) {
-	for (const auto & node : nodes) { add(node); }
+std::vector<MeshNodeId> Scene::add(
+	const std::vector<std::shared_ptr<MeshNode>> &nodes, const TransformHierarchy::Id parent
+) {
+	m_mesh_nodes.reserve(m_mesh_nodes.size() + nodes.size());
+	m_mesh_node_slot_indices.reserve(m_mesh_node_slot_indices.size() + nodes.size());
+	m_transforms->reserve(m_transforms->size() + nodes.size());
+
+	std::vector<MeshNodeId> ids = {};
+	ids.reserve(nodes.size());
+	for (const auto & node : nodes) { ids.push_back(add(node, parent)); }
+	return ids;
 }
 
-void Scene::add(const Scene &scene) { add(scene.m_mesh_nodes); }
+void Scene::add(Scene &&scene) {
+	if (scene.m_transforms == m_transforms) {
+		log::warn("Scene shares its transforms with this scene and can not be added");
+		return;
+	}
 
-void Scene::remove(const std::shared_ptr<MeshNode> node) {
-	auto is_equals = [node](std::shared_ptr<MeshNode> n) { return node == n; };
-	// find the node, move it to the end of the list and erase it
-	m_mesh_nodes.erase(
-		std::remove_if(m_mesh_nodes.begin(), m_mesh_nodes.end(), is_equals), m_mesh_nodes.end()
-	);
+	// the transforms of the mesh nodes and their ancestors, mapped to their copies
+	std::unordered_map<TransformHierarchy::Id, TransformHierarchy::Id> ids = {};
+	for (const auto &node : scene.m_mesh_nodes) {
+		auto id = node->m_transform_id;
+		while (id != TransformHierarchy::invalid_id && ids.emplace(id, TransformHierarchy::invalid_id).second) {
+			id = scene.m_transforms->get_parent(id);
+		}
+	}
+	// copy the hierarchy, parents are visited before their children
+	m_transforms->reserve(m_transforms->size() + ids.size());
+	scene.m_transforms->for_each([&](const auto id, const auto parent, const glm::mat4 &local_matrix) {
+		const auto it = ids.find(id);
+		if (it == ids.end()) return;
+		const auto new_parent = parent != TransformHierarchy::invalid_id
+			? ids.at(parent) : TransformHierarchy::invalid_id;
+		it->second = m_transforms->create(local_matrix, new_parent);
+	});
+
+	m_mesh_nodes.reserve(m_mesh_nodes.size() + scene.m_mesh_nodes.size());
+	m_mesh_node_slot_indices.reserve(m_mesh_node_slot_indices.size() + scene.m_mesh_nodes.size());
+	for (size_t i = 0; i < scene.m_mesh_nodes.size(); i++) {
+		// free the slot in the other scene, the new generation keeps its old ids invalid
+		const auto slot_index = scene.m_mesh_node_slot_indices[i];
+		auto &slot = scene.m_mesh_node_slots[slot_index];
+		scene.m_journal.record(SceneChange(
+			SceneChange::Type::MESH_NODE_REMOVED, MeshNodeId(slot_index, slot.generation)
+		));
+		slot.dense_index = MeshNodeId::invalid_index;
+		slot.generation++;
+		scene.m_free_mesh_node_slots.push_back(slot_index);
+
+		const auto &node = scene.m_mesh_nodes[i];
+		insert(node, ids.at(node->m_transform_id));
+	}
+
+	scene.m_mesh_nodes.clear();
+	scene.m_mesh_node_slot_indices.clear();
+	const auto record_changes = scene.m_transforms->record_changes;
+	scene.m_transforms = std::make_shared<TransformHierarchy>();
+	scene.m_transforms->record_changes = record_changes;
+	scene.m_transform_mesh_nodes.clear();
+	scene.m_changed_transform_ids.clear();
+}
+
+void Scene::remove(const std::shared_ptr<MeshNode> &node) {
+	if (node->m_transforms != m_transforms) return;
+	remove(node->m_scene_id);
+}
+
+void Scene::remove(const MeshNodeId id) {
+	if (!contains(id)) return;
+	auto &slot = m_mesh_node_slots[id.index];
+	const auto node = m_mesh_nodes[slot.dense_index];
+
+	// move the last node into the gap
+	const auto last_slot_index = m_mesh_node_slot_indices.back();
+	m_mesh_nodes[slot.dense_index] = std::move(m_mesh_nodes.back());
+	m_mesh_node_slot_indices[slot.dense_index] = last_slot_index;
+	m_mesh_node_slots[last_slot_index].dense_index = slot.dense_index;
+	m_mesh_nodes.pop_back();
+	m_mesh_node_slot_indices.pop_back();
+
+	slot.dense_index = MeshNodeId::invalid_index;
+	slot.generation++;
+	m_free_mesh_node_slots.push_back(id.index);
+
+	const auto model_matrix = node->get_model_matrix();
+	m_transform_mesh_nodes[node->m_transform_id] = {};
+	m_transforms->remove(node->m_transform_id);
+	node->m_transforms = nullptr;
+	node->m_transform_id = TransformHierarchy::invalid_id;
+	node->m_scene_id = {};
+	node->set_model_matrix(model_matrix);
+	m_journal.record(SceneChange(SceneChange::Type::MESH_NODE_REMOVED, id));
+}
+
+void Scene::remove(const std::vector<std::shared_ptr<MeshNode>> &nodes) {
+	for (const auto &node : nodes) { remove(node); }
+}
+
+void Scene::remove(const std::vector<MeshNodeId> &ids) {
+	for (const auto id : ids) { remove(id); }
+}
+
+TransformHierarchy::Id Scene::add_transform(
+	const glm::mat4 &local_matrix, const TransformHierarchy::Id parent
+) {
+	return m_transforms->create(local_matrix, parent);
+}
+
+TransformHierarchy &Scene::get_transforms() const { return *m_transforms; }
+
+void Scene::update_transforms() const {
+	m_transforms->update();
+	// transforms may also have been updated when a world matrix was read
+	m_transforms->take_changed_ids(m_changed_transform_ids);
+	for (const auto id : m_changed_transform_ids) {
+		if (id >= m_transform_mesh_nodes.size()) continue;
+		const auto mesh_node = m_transform_mesh_nodes[id];
+		if (mesh_node.index == MeshNodeId::invalid_index) continue; // group without a mesh
+		m_journal.record(SceneChange(SceneChange::Type::TRANSFORM_CHANGED, mesh_node));
+	}
+}
+
+const SceneJournal &Scene::get_journal() const {
+	// transform changes are only recorded once there is a consumer, it looks at everything the first
+	// time it sees the journal anyway
+	m_transforms->record_changes = true;
+	update_transforms();
+	return m_journal;
+}
+
+void Scene::notify_material_changed(const std::shared_ptr<Material> &material) {
+	m_journal.record(SceneChange(SceneChange::Type::MATERIAL_CHANGED, MeshNodeId(), material));
 }
 
 void Scene::set_directional_light(const DirectionalLight &directional_light) {
 	*m_directional_light = directional_light;
 	set_light_uniforms(*m_directional_light, global_uniforms);
 	m_directional_light_update_count++;
+	m_journal.record(SceneChange(SceneChange::Type::DIRECTIONAL_LIGHT_CHANGED));
 }
 
 std::shared_ptr<const DirectionalLight> Scene::get_directional_light() const {
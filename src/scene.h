@@ -7,6 +7,8 @@
 #include "uniforms.h"
 #include "lights.h"
 #include "i_spatial.h"
+#include "scene_journal.h"
+#include "transform_hierarchy.h"
 
 namespace ron {
 
@@ -14,6 +16,12 @@ class Scene {
 public:
 	Scene();
 	Scene(std::shared_ptr<Material> default_mat);
+	// forbid copying, the mesh nodes of a scene can only be part of one transform hierarchy
+	// (use add(Scene&&) to move the nodes into another scene)
+	Scene(const Scene&) = delete;
+	Scene &operator=(const Scene&) = delete;
+	Scene(Scene&&) = default;
+	Scene &operator=(Scene&&) = default;
 
 	Uniforms global_uniforms = {};
 	bool depth_test = true;
@@ -23,17 +31,70 @@ public:
 	unsigned int get_directional_light_update_count() const;
 
 	// give read only acces to m_mesh_nodes
+	// the nodes are stored densely, removing a node changes the order of the remaining ones
 	const std::vector<std::shared_ptr<MeshNode>> & get_mesh_nodes() const;
+	// returns nullptr if the node was removed
+	std::shared_ptr<MeshNode> get_mesh_node(const MeshNodeId id) const;
+	bool contains(const MeshNodeId id) const;
 
-	void add(const std::shared_ptr<MeshNode> node);
-	void add(std::vector<std::shared_ptr<MeshNode>> nodes);
-	void add(const Scene &scene);
+	// the current model matrix of the node becomes its local matrix relative to the parent
+	// nodes that are part of another scene are not added, remove them from the other scene first
+	MeshNodeId add(
+		const std::shared_ptr<MeshNode> &node,
+		const TransformHierarchy::Id parent = TransformHierarchy::invalid_id
+	);
+	std::vector<MeshNodeId> add(
+		const std::vector<std::shared_ptr<MeshNode>> &nodes,
+		const TransformHierarchy::Id parent = TransformHierarchy::invalid_id
+	);
+	// moves the mesh nodes of the other scene into this one, the other scene is empty afterwards
+	// the transforms of the mesh nodes and their ancestors are copied, transforms without a mesh node
+	// below them are not
+	void add(Scene &&scene);
 
-	void remove(const std::shared_ptr<MeshNode> node);
+	// the node keeps its current model matrix, its children are attached to its parent
+	void remove(const std::shared_ptr<MeshNode> &node);
+	void remove(const MeshNodeId id);
+	void remove(const std::vector<std::shared_ptr<MeshNode>> &nodes);
+	void remove(const std::vector<MeshNodeId> &ids);
+
+	// transform without a mesh, e.g. to move a group of mesh nodes together
+	TransformHierarchy::Id add_transform(
+		const glm::mat4 &local_matrix, const TransformHierarchy::Id parent = TransformHierarchy::invalid_id
+	);
+	TransformHierarchy &get_transforms() const;
+	// recalculates the world matrices of moved transforms, done by the renderer before rendering
+	void update_transforms() const;
+
+	// changes of the scene, consumers only process the changes since they last looked
+	// transform changes are recorded when the transforms are updated, which is done first.
+	// they are only recorded after the journal was requested once, consumers have to look at every
+	// mesh node the first time they see a journal
+	const SceneJournal &get_journal() const;
+	// materials are shared and changed directly, report changes so consumers can pick them up
+	void notify_material_changed(const std::shared_ptr<Material> &material);
 
 	std::shared_ptr<Material> default_material;
 private:
+	struct MeshNodeSlot {
+		uint32_t dense_index = MeshNodeId::invalid_index; // invalid -> slot is free
+		uint32_t generation = 0;
+	};
+
+	// slot map, ids index m_mesh_node_slots, which point into the dense arrays
 	std::vector<std::shared_ptr<MeshNode>> m_mesh_nodes = {};
+	std::vector<uint32_t> m_mesh_node_slot_indices = {}; // parallel to m_mesh_nodes
+	std::vector<MeshNodeSlot> m_mesh_node_slots = {};
+	std::vector<uint32_t> m_free_mesh_node_slots = {};
+
+	MeshNodeId insert(const std::shared_ptr<MeshNode> &node, const TransformHierarchy::Id transform_id);
+	// shared with the mesh nodes, which read their matrices from it
+	std::shared_ptr<TransformHierarchy> m_transforms = std::make_shared<TransformHierarchy>();
+	// mesh node of every transform id, invalid for transforms without a mesh
+	std::vector<MeshNodeId> m_transform_mesh_nodes = {};
+
+	mutable SceneJournal m_journal = {};
+	mutable std::vector<TransformHierarchy::Id> m_changed_transform_ids = {};
 
 	std::shared_ptr<DirectionalLight> m_directional_light = std::make_shared<DirectionalLight>();
 	unsigned int m_directional_light_update_count = 0;
@@ -0,0 +1,44 @@
+#include "scene_journal.h"
+
+#include <atomic>
+#include <cassert>
+
+using namespace ron;
+
+static std::atomic<uint64_t> next_journal_id = 0;
+
+SceneJournal::SceneJournal() : m_id(next_journal_id++) {}
+
+SceneJournal::SceneJournal(const SceneJournal &other)
+	: capacity(other.capacity), m_id(next_journal_id++), m_changes(other.m_changes), m_begin(other.m_begin) {}
+
+SceneJournal &SceneJournal::operator=(const SceneJournal &other) {
+	capacity = other.capacity;
+	m_id = next_journal_id++;
+	m_changes = other.m_changes;
+	m_begin = other.m_begin;
+	return *this;
+}
+
+uint64_t SceneJournal::get_id() const { return m_id; }
+
+uint64_t SceneJournal::get_end() const { return m_begin + m_changes.size(); }
+
+bool SceneJournal::contains(const uint64_t sequence_number) const {
+	return sequence_number >= m_begin && sequence_number <= get_end();
+}
+
+std::span<const SceneChange> SceneJournal::get_since(const uint64_t sequence_number) const {
+	assert(contains(sequence_number));
+	return std::span<const SceneChange>(m_changes).subspan(sequence_number - m_begin);
+}
+
+void SceneJournal::record(SceneChange change) {
+	if (m_changes.size() >= capacity) {
+		// drop the older half, so this does not happen on every change
+		const auto dropped = m_changes.size() - capacity / 2;
+		m_changes.erase(m_changes.begin(), m_changes.begin() + dropped);
+		m_begin += dropped;
+	}
+	m_changes.push_back(std::move(change));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "material.h"
+#include "meshes.h"
+
+namespace ron {
+
+struct SceneChange {
+	enum class Type {
+		MESH_NODE_ADDED,
+		MESH_NODE_REMOVED, // the id of the node is stale already
+		TRANSFORM_CHANGED, // the world matrix of the mesh node was recalculated
+		MATERIAL_CHANGED, // reported by the user, see Scene::notify_material_changed
+		DIRECTIONAL_LIGHT_CHANGED
+	};
+
+	Type type;
+	MeshNodeId mesh_node = {}; // mesh node and transform changes
+	std::shared_ptr<Material> material = nullptr; // material changes
+};
+
+// append only list of the changes of a scene, consumers (e.g. renderers) remember the sequence number
+// up to which they have seen the changes and only process newer ones.
+// at most capacity changes are kept, a consumer that falls further behind has to resynchronize
+// everything, it notices that through contains
+class SceneJournal {
+public:
+	SceneJournal();
+	// a copy is a different journal, it gets a new id
+	SceneJournal(const SceneJournal &other);
+	SceneJournal &operator=(const SceneJournal &other);
+	SceneJournal(SceneJournal &&other) = default;
+	SceneJournal &operator=(SceneJournal &&other) = default;
+
+	size_t capacity = 1 << 16;
+
+	// unique per journal, so consumers can tell apart scenes that were created at the same address
+	uint64_t get_id() const;
+	// sequence number of the next change
+	uint64_t get_end() const;
+	// whether all changes since the sequence number are still kept
+	bool contains(const uint64_t sequence_number) const;
+	// changes since the sequence number, which has to be contained
+	std::span<const SceneChange> get_since(const uint64_t sequence_number) const;
+
+	void record(SceneChange change);
+private:
+	uint64_t m_id;
+	std::vector<SceneChange> m_changes = {};
+	uint64_t m_begin = 0; // sequence number of m_changes[0]
+};
+
+} // ron
@@ -0,0 +1,79 @@
+#include "scene_snapshot.h"
+
+using namespace ron;
+
+void SceneSnapshotBuilder::build(const Scene &scene, const ICamera &camera, SceneSnapshot &snapshot) {
+	m_tick++;
+	// also updates the transforms of the scene
+	apply_scene_changes(scene);
+
+	snapshot.tick = m_tick;
+	snapshot.mesh_nodes.clear();
+	snapshot.mesh_nodes.reserve(scene.get_mesh_nodes().size());
+	for (const auto &mesh_node : scene.get_mesh_nodes()) {
+		snapshot.mesh_nodes.push_back(SceneSnapshot::MeshNodeEntry(
+			mesh_node->get_scene_id(), copy_mesh(mesh_node->get_mesh()), mesh_node->get_model_matrix()
+		));
+	}
+	snapshot.global_uniforms = scene.global_uniforms;
+	snapshot.depth_test = scene.depth_test;
+	snapshot.default_material = scene.default_material ? copy_material(scene.default_material) : nullptr;
+	snapshot.directional_light = *scene.get_directional_light();
+	snapshot.directional_light_update_count = scene.get_directional_light_update_count();
+	snapshot.camera_model_matrix = camera.get_model_matrix();
+	snapshot.camera_projection_matrix = camera.get_projection_matrix();
+
+	// meshes that were not used are not part of the scene anymore, materials that are not referenced
+	// by any mesh copy or snapshot are not used anymore either
+	std::erase_if(m_meshes, [this](const auto &entry) { return entry.second.last_used_tick != m_tick; });
+	std::erase_if(m_materials, [](const auto &entry) { return entry.second.copy.use_count() == 1; });
+}
+
+void SceneSnapshotBuilder::apply_scene_changes(const Scene &scene) {
+	const auto &journal = scene.get_journal();
+	if (journal.get_id() != m_journal_id || !journal.contains(m_journal_position)) {
+		// another scene, or too many changes were missed -> copy everything again
+		m_materials.clear();
+		m_meshes.clear();
+	}
+	else {
+		for (const auto &change : journal.get_since(m_journal_position)) {
+			if (change.type != SceneChange::Type::MATERIAL_CHANGED || !change.material) continue;
+
+			m_materials.erase(change.material.get());
+			std::erase_if(m_meshes, [&change](const auto &entry) {
+				const auto source = entry.second.source.lock();
+				if (!source) return true;
+				for (const auto &section : source->sections) {
+					if (section.material == change.material) return true;
+				}
+				return false;
+			});
+		}
+	}
+	m_journal_id = journal.get_id();
+	m_journal_position = journal.get_end();
+}
+
+const std::shared_ptr<Material> &SceneSnapshotBuilder::copy_material(const std::shared_ptr<Material> &material) {
+	auto &entry = m_materials[material.get()];
+	if (!entry.copy || entry.source.expired()) {
+		entry.source = material;
+		entry.copy = std::make_shared<Material>(*material);
+	}
+	return entry.copy;
+}
+
+const std::shared_ptr<Mesh> &SceneSnapshotBuilder::copy_mesh(const std::shared_ptr<Mesh> &mesh) {
+	auto &entry = m_meshes[mesh.get()];
+	if (!entry.copy || entry.source.expired()) {
+		auto copy = std::make_shared<Mesh>(*mesh);
+		for (auto &section : copy->sections) {
+			if (section.material) section.material = copy_material(section.material);
+		}
+		entry.source = mesh;
+		entry.copy = std::move(copy);
+	}
+	entry.last_used_tick = m_tick;
+	return entry.copy;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "i_camera.h"
+#include "lights.h"
+#include "material.h"
+#include "meshes.h"
+#include "scene.h"
+#include "uniforms.h"
+
+namespace ron {
+
+// what is needed to render a scene from a camera, filled on the thread that changes the scene and
+// rendered on another one (see OpenGLRenderThread). the hierarchy is flattened into world matrices
+// meshes and materials are copies that do not change after they were published. geometries, textures,
+// shader programs and uniform values are shared with the scene, replace them instead of changing them
+struct SceneSnapshot {
+	struct MeshNodeEntry {
+		MeshNodeId id; // in the scene the snapshot was taken of
+		std::shared_ptr<Mesh> mesh;
+		glm::mat4 model_matrix;
+	};
+
+	uint64_t tick = 0; // counts the snapshots of a SceneSnapshotBuilder, starting at 1
+	std::vector<MeshNodeEntry> mesh_nodes = {};
+	Uniforms global_uniforms = {};
+	bool depth_test = true;
+	std::shared_ptr<Material> default_material = nullptr;
+	DirectionalLight directional_light = {};
+	unsigned int directional_light_update_count = 0;
+	glm::mat4 camera_model_matrix = glm::mat4(1.0f);
+	glm::mat4 camera_projection_matrix = glm::mat4(1.0f);
+};
+
+// fills snapshots of a scene. meshes and materials are copied the first time they are seen,
+// materials are copied again when the scene reports that they changed (see Scene::notify_material_changed)
+// the sections of a mesh are expected not to change while the mesh is in the scene
+class SceneSnapshotBuilder {
+public:
+	// the snapshot is overwritten, its memory is reused
+	void build(const Scene &scene, const ICamera &camera, SceneSnapshot &snapshot);
+private:
+	// the copies are looked up by the address of the source, which may be reused after the source
+	// is destroyed -> the weak pointer tells whether the copy is still of the same source
+	struct MaterialCopy {
+		std::weak_ptr<Material> source;
+		std::shared_ptr<Material> copy;
+	};
+	struct MeshCopy {
+		std::weak_ptr<Mesh> source;
+		std::shared_ptr<Mesh> copy;
+		uint64_t last_used_tick;
+	};
+
+	uint64_t m_tick = 0;
+	uint64_t m_journal_id = UINT64_MAX;
+	uint64_t m_journal_position = 0;
+	std::unordered_map<const Material *, MaterialCopy> m_materials = {};
+	std::unordered_map<const Mesh *, MeshCopy> m_meshes = {};
+
+	// drops the copies of changed materials and of the meshes that use them
+	void apply_scene_changes(const Scene &scene);
+	const std::shared_ptr<Material> &copy_material(const std::shared_ptr<Material> &material);
+	const std::shared_ptr<Mesh> &copy_mesh(const std::shared_ptr<Mesh> &mesh);
+};
+
+} // ron
@@ -1,6 +1,8 @@
 #include "texture.h"
 
 #include <cassert>
+#include <cstdlib>
+#include <fstream>
 
 #include <stb_image.h>
 
@@ -50,18 +52,80 @@ Texture::ImageData Texture::image_data_from_file(
 	return image_data;
 }
 
-Texture::~Texture() { if (good()) stbi_image_free(image_data.data_ptr); }
+void Texture::free_image_data(ImageData &image_data) {
+	stbi_image_free(image_data.data_ptr);
+	image_data.data_ptr = nullptr;
+}
+
+Texture::~Texture() { if (has_image_data()) stbi_image_free(image_data.data_ptr); }
+
+bool Texture::good() const { return has_image_data() || m_released; }
 
-bool Texture::good() const { return image_data.data_ptr; }
+bool Texture::has_image_data() const { return image_data.data_ptr; }
 
 unsigned int Texture::get_update_count() const { return m_update_count; }
 
 void Texture::update(const ImageData image_data) {
-	if (good()) {
-		stbi_image_free(image_data.data_ptr);
+	// free the previous data, not the new one
+	if (has_image_data()) {
+		stbi_image_free(this->image_data.data_ptr);
 	}
 	this->image_data = image_data;
+	m_released = false;
+	m_cooked_cache_path = nullptr;
 	m_update_count++;
 }
 
 void Texture::mark_as_updated() { m_update_count++; }
+
+bool Texture::is_released() const { return m_released; }
+
+void Texture::release_image_data() {
+	if (residency == Residency::KEEP || !has_image_data()) {
+		return;
+	}
+
+	if (residency == Residency::RELOAD_FROM_SOURCE_ON_DEMAND && !image_data_source) {
+		const auto size = static_cast<size_t>(image_data.width) * image_data.height * image_data.n_channels;
+		m_cooked_cache_path = create_cooked_cache_path("texture");
+		std::ofstream file(*m_cooked_cache_path, std::ios::binary);
+		file.write(reinterpret_cast<const char *>(image_data.data_ptr), size);
+		if (!file) {
+			log::warn("Could not write cooked cache of texture " + name + ", keeping it in memory");
+			m_cooked_cache_path = nullptr;
+			return;
+		}
+	}
+
+	stbi_image_free(image_data.data_ptr);
+	image_data.data_ptr = nullptr; // keep the size, it is needed to read the cooked cache
+	m_released = true;
+}
+
+bool Texture::restore_image_data() {
+	if (!m_released || residency != Residency::RELOAD_FROM_SOURCE_ON_DEMAND) {
+		return has_image_data();
+	}
+
+	if (image_data_source) {
+		image_data = image_data_source();
+	}
+	else if (m_cooked_cache_path) {
+		const auto size = static_cast<size_t>(image_data.width) * image_data.height * image_data.n_channels;
+		// allocate like stb_image does, so stbi_image_free can free it
+		image_data.data_ptr = static_cast<unsigned char *>(std::malloc(size));
+		std::ifstream file(*m_cooked_cache_path, std::ios::binary);
+		file.read(reinterpret_cast<char *>(image_data.data_ptr), size);
+		if (!file) {
+			std::free(image_data.data_ptr);
+			image_data.data_ptr = nullptr;
+		}
+	}
+
+	if (!has_image_data()) {
+		log::error("Failed to restore released texture " + name);
+		return false;
+	}
+	m_released = false;
+	return true;
+}
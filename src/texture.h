@@ -1,7 +1,11 @@
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <string>
 
+#include "residency.h"
+
 namespace ron {
 
 class Texture {
@@ -51,23 +55,44 @@ public:
 		const unsigned char *memory, const int len
 	);
 
+	// safe to call from any thread
 	static ImageData image_data_from_file(
 		const std::string &absolute_path
 	);
+	// only for image data that was not passed to a texture, textures free their own data
+	static void free_image_data(ImageData &image_data);
 
 	const std::string name;
 
-	bool good() const; // true if texture is valid
+	// true if the texture has valid image data, also after the data was released (see residency)
+	bool good() const;
+	// false if the image data failed to load or was released
+	bool has_image_data() const;
 	unsigned int get_update_count() const;
 
 	ImageData image_data;
 	MetaData meta_data;
 	SampleData sample_data;
 
+	// the renderer calls release_image_data after uploading unless this is KEEP
+	Residency residency = Residency::KEEP;
+	// used to restore released image data with RELOAD_FROM_SOURCE_ON_DEMAND, e.g. set by
+	// assets::load_texture. without a source the data is written to a cooked cache file instead
+	std::function<ImageData()> image_data_source = {};
+
 	void update(const ImageData image_data);
 	void mark_as_updated(); // call this after modifying image_data
+
+	// frees image_data according to residency, does not count as an update
+	void release_image_data();
+	// loads released image data again, returns has_image_data().
+	// data released with RELEASE_AFTER_UPLOAD can not be restored
+	bool restore_image_data();
+	bool is_released() const;
 private:
 	unsigned int m_update_count = 0;
+	bool m_released = false;
+	std::shared_ptr<const std::string> m_cooked_cache_path = {};
 };
 
 } // ron
@@ -0,0 +1,91 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+#include "profiler.h"
+
+using ron::ThreadPool;
+
+ThreadPool::ThreadPool(const unsigned int worker_count) {
+	// hardware_concurrency may return 0 if it is unknown -> worker_count underflowed
+	const auto count = std::min(worker_count, std::max(std::thread::hardware_concurrency(), 1u));
+	m_workers.reserve(count);
+	for (unsigned int i = 0; i < count; i++) {
+		m_workers.emplace_back(&ThreadPool::worker_loop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_job_available.notify_all();
+	for (auto &worker : m_workers) { worker.join(); }
+}
+
+unsigned int ThreadPool::get_worker_count() const { return m_workers.size(); }
+
+void ThreadPool::parallel_for(
+	const size_t count, const std::function<void(size_t, size_t)> &function,
+	const size_t min_chunk_size
+) {
+	if (count == 0) return;
+
+	// a few chunks per thread, so threads that finish early can help out the others
+	const size_t thread_count = m_workers.size() + 1;
+	const auto chunk_size = std::max(min_chunk_size, (count + thread_count * 4 - 1) / (thread_count * 4));
+	const auto chunk_count = (count + chunk_size - 1) / chunk_size;
+
+	if (chunk_count == 1 || m_workers.empty()) {
+		function(0, count);
+		return;
+	}
+
+	const auto job = std::make_shared<Job>(function, count, chunk_size, chunk_count);
+	{
+		std::lock_guard lock(m_mutex);
+		m_job = job;
+		m_job_generation++;
+	}
+	m_job_available.notify_all();
+
+	run_chunks(*job);
+
+	std::unique_lock lock(m_mutex);
+	m_job_finished.wait(lock, [&]() { return job->finished_chunks == job->chunk_count; });
+	m_job = {};
+}
+
+void ThreadPool::run_chunks(Job &job) {
+	size_t chunk;
+	while ((chunk = job.next_chunk++) < job.chunk_count) {
+		const auto begin = chunk * job.chunk_size;
+		const auto end = std::min(begin + job.chunk_size, job.count);
+		job.function(begin, end);
+		if (++job.finished_chunks == job.chunk_count) {
+			// lock, so the notification can not get lost between the check and the wait
+			std::lock_guard lock(m_mutex);
+			m_job_finished.notify_all();
+		}
+	}
+}
+
+void ThreadPool::worker_loop() {
+	RON_PROFILE_THREAD("worker");
+	uint64_t last_job_generation = 0;
+	while (true) {
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock lock(m_mutex);
+			m_job_available.wait(lock, [&]() {
+				return m_stop || (m_job && m_job_generation != last_job_generation);
+			});
+			if (m_stop) return;
+			last_job_generation = m_job_generation;
+			job = m_job;
+		}
+		// the job is kept alive by the shared_ptr, even if parallel_for already returned
+		run_chunks(*job);
+	}
+}
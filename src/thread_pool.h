@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ron {
+
+class ThreadPool {
+public:
+	// the calling thread also works on parallel_for, so by default one thread less is created
+	// the worker count is limited to the number of hardware threads
+	ThreadPool(const unsigned int worker_count = std::thread::hardware_concurrency() - 1);
+	~ThreadPool();
+	// forbid copying
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool &operator=(const ThreadPool&) = delete;
+
+	// splits [0, count) into chunks of at least min_chunk_size and calls function(begin, end)
+	// for every chunk on the workers and the calling thread. returns when all chunks are done.
+	// must not be called from multiple threads at the same time.
+	void parallel_for(
+		const size_t count, const std::function<void(size_t, size_t)> &function,
+		const size_t min_chunk_size = 1
+	);
+
+	unsigned int get_worker_count() const;
+private:
+	struct Job {
+		std::function<void(size_t, size_t)> function;
+		size_t count;
+		size_t chunk_size;
+		size_t chunk_count;
+		std::atomic<size_t> next_chunk = 0;
+		std::atomic<size_t> finished_chunks = 0;
+	};
+
+	std::vector<std::thread> m_workers = {};
+	std::mutex m_mutex = {};
+	std::condition_variable m_job_available = {};
+	std::condition_variable m_job_finished = {};
+	std::shared_ptr<Job> m_job = {};
+	uint64_t m_job_generation = 0;
+	bool m_stop = false;
+
+	void worker_loop();
+	void run_chunks(Job &job);
+};
+
+} // ron
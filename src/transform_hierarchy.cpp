@@ -0,0 +1,232 @@
+#include "transform_hierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace ron;
+
+TransformHierarchy::Id TransformHierarchy::create(const glm::mat4 &local_matrix, const Id parent) {
+	assert(parent == invalid_id || contains(parent));
+
+	Id id;
+	if (!m_free_ids.empty()) {
+		id = m_free_ids.back();
+		m_free_ids.pop_back();
+	}
+	else {
+		id = static_cast<Id>(m_indices.size());
+		m_indices.push_back(invalid_index);
+	}
+
+	// appending keeps the topological order, the parent is already stored
+	const auto index = static_cast<uint32_t>(m_ids.size());
+	m_indices[id] = index;
+	m_ids.push_back(id);
+	m_parents.push_back(parent != invalid_id ? m_indices[parent] : invalid_index);
+	m_local_matrices.push_back(local_matrix);
+	m_world_matrices.push_back(local_matrix);
+	m_normal_matrices.push_back(glm::mat3(1.0f));
+	m_dirty.push_back(0);
+	m_child_counts.push_back(0);
+	if (parent != invalid_id) m_child_counts[m_indices[parent]]++;
+	mark_dirty(index);
+	return id;
+}
+
+void TransformHierarchy::remove(const Id id) {
+	assert(contains(id));
+	const auto index = m_indices[id];
+	const auto parent_index = m_parents[index];
+
+	// attach the children to the parent, without changing their world matrices
+	// while unsorted, children may be stored before their parent
+	for (size_t i = m_needs_sorting ? 0 : index + 1; i < m_ids.size(); i++) {
+		if (m_child_counts[index] == 0) break;
+		if (m_parents[i] != index) continue;
+		m_parents[i] = parent_index;
+		m_local_matrices[i] = m_local_matrices[index] * m_local_matrices[i];
+		// a pending change of the removed transform is lost with its dirty flag during compaction
+		mark_dirty(static_cast<uint32_t>(i));
+		m_child_counts[index]--;
+		if (parent_index != invalid_index) m_child_counts[parent_index]++;
+	}
+	if (parent_index != invalid_index) m_child_counts[parent_index]--;
+
+	m_ids[index] = invalid_id;
+	m_indices[id] = invalid_index;
+	m_free_ids.push_back(id);
+	m_needs_compaction = true;
+}
+
+bool TransformHierarchy::contains(const Id id) const {
+	return id < m_indices.size() && m_indices[id] != invalid_index;
+}
+
+size_t TransformHierarchy::size() const { return m_indices.size() - m_free_ids.size(); }
+
+void TransformHierarchy::reserve(const size_t count) {
+	m_ids.reserve(count);
+	m_parents.reserve(count);
+	m_local_matrices.reserve(count);
+	m_world_matrices.reserve(count);
+	m_normal_matrices.reserve(count);
+	m_dirty.reserve(count);
+	m_child_counts.reserve(count);
+	m_indices.reserve(count);
+}
+
+bool TransformHierarchy::set_parent(const Id id, const Id parent) {
+	assert(contains(id));
+	assert(parent == invalid_id || contains(parent));
+	const auto index = m_indices[id];
+	const auto parent_index = parent != invalid_id ? m_indices[parent] : invalid_index;
+
+	// a transform can not be its own ancestor
+	for (auto i = parent_index; i != invalid_index; i = m_parents[i]) {
+		if (i == index) return false;
+	}
+
+	if (m_parents[index] != invalid_index) m_child_counts[m_parents[index]]--;
+	if (parent_index != invalid_index) m_child_counts[parent_index]++;
+	m_parents[index] = parent_index;
+	if (parent_index != invalid_index && parent_index > index) {
+		m_needs_sorting = true;
+	}
+	mark_dirty(index);
+	return true;
+}
+
+TransformHierarchy::Id TransformHierarchy::get_parent(const Id id) const {
+	assert(contains(id));
+	const auto parent_index = m_parents[m_indices[id]];
+	return parent_index != invalid_index ? m_ids[parent_index] : invalid_id;
+}
+
+void TransformHierarchy::set_local_matrix(const Id id, const glm::mat4 &local_matrix) {
+	assert(contains(id));
+	const auto index = m_indices[id];
+	m_local_matrices[index] = local_matrix;
+	mark_dirty(index);
+}
+
+const glm::mat4 &TransformHierarchy::get_local_matrix(const Id id) const {
+	assert(contains(id));
+	return m_local_matrices[m_indices[id]];
+}
+
+const glm::mat4 &TransformHierarchy::get_world_matrix(const Id id) {
+	assert(contains(id));
+	if (is_dirty()) update();
+	return m_world_matrices[m_indices[id]];
+}
+
+const glm::mat3 &TransformHierarchy::get_normal_matrix(const Id id) {
+	assert(contains(id));
+	if (is_dirty()) update();
+	return m_normal_matrices[m_indices[id]];
+}
+
+bool TransformHierarchy::is_dirty() const { return m_first_dirty != SIZE_MAX; }
+
+void TransformHierarchy::update() {
+	if (m_needs_compaction || m_needs_sorting) {
+		reorder();
+	}
+	m_last_update_count = 0;
+	if (!is_dirty()) return;
+
+	// parents are stored before their children, so a dirty parent was handled before its children
+	for (size_t i = m_first_dirty; i < m_ids.size(); i++) {
+		const auto parent = m_parents[i];
+		if (parent != invalid_index && m_dirty[parent]) {
+			m_dirty[i] = 1;
+		}
+		if (!m_dirty[i]) continue;
+
+		m_world_matrices[i] = parent != invalid_index
+			? m_world_matrices[parent] * m_local_matrices[i] : m_local_matrices[i];
+		m_normal_matrices[i] = glm::transpose(glm::inverse(glm::mat3(m_world_matrices[i])));
+		m_last_update_count++;
+		if (record_changes) {
+			const auto id = m_ids[i];
+			if (m_changed.size() <= id) m_changed.resize(m_indices.size(), 0);
+			if (!m_changed[id]) {
+				m_changed[id] = 1;
+				m_changed_ids.push_back(id);
+			}
+		}
+	}
+	std::fill(m_dirty.begin() + m_first_dirty, m_dirty.end(), 0);
+	m_first_dirty = SIZE_MAX;
+}
+
+size_t TransformHierarchy::get_last_update_count() const { return m_last_update_count; }
+
+void TransformHierarchy::take_changed_ids(std::vector<Id> &ids) {
+	for (const auto id : m_changed_ids) { m_changed[id] = 0; }
+	ids.clear();
+	std::swap(ids, m_changed_ids);
+}
+
+void TransformHierarchy::mark_dirty(const uint32_t index) {
+	m_dirty[index] = 1;
+	m_first_dirty = std::min(m_first_dirty, static_cast<size_t>(index));
+}
+
+void TransformHierarchy::reorder() {
+	std::vector<uint32_t> order = {};
+	order.reserve(size());
+	for (uint32_t i = 0; i < m_ids.size(); i++) {
+		if (m_ids[i] != invalid_id) order.push_back(i);
+	}
+
+	if (m_needs_sorting) {
+		// sorting by depth puts parents before their children
+		std::vector<uint32_t> depths(m_ids.size(), invalid_index);
+		std::vector<uint32_t> chain = {};
+		for (const auto i : order) {
+			// walk up until the depth of an ancestor is known
+			auto current = i;
+			while (current != invalid_index && depths[current] == invalid_index) {
+				chain.push_back(current);
+				current = m_parents[current];
+			}
+			auto depth = current != invalid_index ? depths[current] + 1 : 0;
+			for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+				depths[*it] = depth++;
+			}
+			chain.clear();
+		}
+		std::stable_sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) {
+			return depths[a] < depths[b];
+		});
+	}
+
+	std::vector<uint32_t> new_indices(m_ids.size(), invalid_index);
+	for (uint32_t i = 0; i < order.size(); i++) {
+		new_indices[order[i]] = i;
+	}
+
+	const auto permute = [&order](auto &values) {
+		std::remove_reference_t<decltype(values)> permuted = {};
+		permuted.reserve(order.size());
+		for (const auto i : order) { permuted.push_back(values[i]); }
+		values = std::move(permuted);
+	};
+	permute(m_ids);
+	permute(m_parents);
+	permute(m_local_matrices);
+	permute(m_world_matrices);
+	permute(m_normal_matrices);
+	permute(m_dirty);
+	permute(m_child_counts);
+
+	m_first_dirty = SIZE_MAX;
+	for (uint32_t i = 0; i < m_ids.size(); i++) {
+		if (m_parents[i] != invalid_index) m_parents[i] = new_indices[m_parents[i]];
+		m_indices[m_ids[i]] = i;
+		if (m_dirty[i]) m_first_dirty = std::min(m_first_dirty, static_cast<size_t>(i));
+	}
+	m_needs_compaction = false;
+	m_needs_sorting = false;
+}
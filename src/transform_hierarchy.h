@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace ron {
+
+// parent child hierarchy of transforms
+// the transforms are stored as structure of arrays in topological order (parents before children),
+// so world matrices are updated in one linear pass that only recalculates dirty subtrees
+class TransformHierarchy {
+public:
+	// stable identifier of a transform, stays valid until the transform is removed
+	using Id = uint32_t;
+	static constexpr Id invalid_id = UINT32_MAX;
+
+	Id create(const glm::mat4 &local_matrix, const Id parent = invalid_id);
+	// children of the removed transform are attached to its parent, their world matrices do not change
+	void remove(const Id id);
+	bool contains(const Id id) const;
+	size_t size() const;
+	void reserve(const size_t count);
+
+	// the local matrix of the transform is kept, so its world matrix changes
+	// returns false if the parent is the transform itself or one of its descendants
+	bool set_parent(const Id id, const Id parent);
+	Id get_parent(const Id id) const;
+
+	void set_local_matrix(const Id id, const glm::mat4 &local_matrix);
+	const glm::mat4 &get_local_matrix(const Id id) const;
+	// updates the hierarchy first if it is dirty
+	const glm::mat4 &get_world_matrix(const Id id);
+	const glm::mat3 &get_normal_matrix(const Id id);
+
+	bool is_dirty() const;
+	// recalculates the world and normal matrices of dirty transforms and their descendants
+	void update();
+	// number of world matrices recalculated by the last update
+	size_t get_last_update_count() const;
+
+	// collect the ids of the transforms whose world matrices were recalculated, every id is collected
+	// once until the ids are taken, so the list never grows beyond the number of transforms
+	bool record_changes = false;
+	// moves the ids collected since the last call into ids
+	void take_changed_ids(std::vector<Id> &ids);
+
+	// calls function(Id id, Id parent, const glm::mat4 &local_matrix) in topological order
+	template <typename Function>
+	void for_each(const Function &function) {
+		update();
+		for (size_t i = 0; i < m_ids.size(); i++) {
+			const auto parent = m_parents[i] != invalid_index ? m_ids[m_parents[i]] : invalid_id;
+			function(m_ids[i], parent, m_local_matrices[i]);
+		}
+	}
+private:
+	static constexpr uint32_t invalid_index = UINT32_MAX;
+
+	// indexed by position in the topological order
+	std::vector<Id> m_ids = {}; // invalid_id -> removed, compacted during the next update
+	std::vector<uint32_t> m_parents = {};
+	std::vector<glm::mat4> m_local_matrices = {};
+	std::vector<glm::mat4> m_world_matrices = {};
+	std::vector<glm::mat3> m_normal_matrices = {};
+	std::vector<uint8_t> m_dirty = {};
+	// removing transforms without children does not need to search for children
+	std::vector<uint32_t> m_child_counts = {};
+
+	// indexed by id
+	std::vector<uint32_t> m_indices = {};
+	std::vector<Id> m_free_ids = {};
+
+	size_t m_first_dirty = SIZE_MAX;
+	bool m_needs_compaction = false;
+	bool m_needs_sorting = false;
+	size_t m_last_update_count = 0;
+	std::vector<Id> m_changed_ids = {};
+	std::vector<uint8_t> m_changed = {}; // indexed by id, set while the id is in m_changed_ids
+
+	void mark_dirty(const uint32_t index);
+	// brings the arrays into topological order and removes the entries of removed transforms
+	void reorder();
+};
+
+} // ron
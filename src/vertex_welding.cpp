@@ -0,0 +1,134 @@
+#include "meshes.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace ron;
+
+static const uint32_t empty_slot = std::numeric_limits<uint32_t>::max();
+
+// convert a float to an integer, so that values that should be considered equal map to the same
+// integer. with an epsilon of 0 the exact bit pattern is used (-0.0 and 0.0 are treated as equal)
+static int64_t quantize(const float value, const float epsilon) {
+	if (epsilon > 0.0f) {
+		return static_cast<int64_t>(std::floor(value / epsilon + 0.5f));
+	}
+	if (value == 0.0f) {
+		return 0;
+	}
+	int32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static uint64_t hash_combine(uint64_t hash, const int64_t value) {
+	// 64 bit variant of boost::hash_combine
+	hash ^= static_cast<uint64_t>(value) + 0x9e3779b97f4a7c15ull + (hash << 12) + (hash >> 4);
+	return hash;
+}
+
+struct WeldContext {
+	const Geometry &geometry;
+	const float epsilon;
+
+	// calls function for every float component of the vertex
+	template <typename F> void for_each_component(const uint32_t vertex, F function) const {
+		const auto &position = geometry.positions[vertex];
+		function(position.x); function(position.y); function(position.z);
+		if (!geometry.normals.empty()) {
+			const auto &normal = geometry.normals[vertex];
+			function(normal.x); function(normal.y); function(normal.z);
+		}
+		if (!geometry.uvs.empty()) {
+			const auto &uv = geometry.uvs[vertex];
+			function(uv.x); function(uv.y);
+		}
+		if (!geometry.tangents.empty()) {
+			const auto &tangent = geometry.tangents[vertex];
+			function(tangent.x); function(tangent.y); function(tangent.z); function(tangent.w);
+		}
+	}
+
+	uint64_t hash(const uint32_t vertex) const {
+		uint64_t hash = 0;
+		for_each_component(vertex, [&](const float value) {
+			hash = hash_combine(hash, quantize(value, epsilon));
+		});
+		return hash;
+	}
+
+	bool equal(const uint32_t a, const uint32_t b) const {
+		int64_t components_a[16];
+		unsigned int count = 0;
+		for_each_component(a, [&](const float value) {
+			components_a[count++] = quantize(value, epsilon);
+		});
+		bool equal = true;
+		count = 0;
+		for_each_component(b, [&](const float value) {
+			equal = equal && components_a[count++] == quantize(value, epsilon);
+		});
+		return equal;
+	}
+};
+
+std::vector<uint32_t> ron::weld_vertices(Geometry &geometry, const float epsilon) {
+	const auto vertex_count = static_cast<uint32_t>(geometry.positions.size());
+	assert(geometry.normals.empty() || geometry.normals.size() == vertex_count);
+	assert(geometry.uvs.empty() || geometry.uvs.size() == vertex_count);
+	assert(geometry.tangents.empty() || geometry.tangents.size() == vertex_count);
+	assert(epsilon >= 0.0f);
+
+	const WeldContext context = { geometry, epsilon };
+
+	// open addressing hash table that stores the first occurence of every unique vertex
+	// the size is a power of two that is at least twice the vertex count to keep the probes short
+	size_t table_size = 1;
+	while (table_size < 2 * static_cast<size_t>(vertex_count)) { table_size *= 2; }
+	std::vector<uint32_t> table(table_size, empty_slot);
+
+	std::vector<uint32_t> remap(vertex_count, empty_slot);
+	std::vector<uint32_t> unique_vertices = {}; // old index of every new vertex
+	unique_vertices.reserve(vertex_count);
+
+	for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+		auto slot = context.hash(vertex) & (table_size - 1);
+		while (table[slot] != empty_slot && !context.equal(table[slot], vertex)) {
+			slot = (slot + 1) & (table_size - 1); // linear probing
+		}
+		if (table[slot] == empty_slot) {
+			table[slot] = vertex;
+			remap[vertex] = static_cast<uint32_t>(unique_vertices.size());
+			unique_vertices.push_back(vertex);
+		}
+		else {
+			remap[vertex] = remap[table[slot]];
+		}
+	}
+
+	// nothing to weld -> keep the geometry as it is
+	if (unique_vertices.size() == vertex_count) {
+		return remap;
+	}
+
+	const auto compact = [&unique_vertices](auto &attribute) {
+		if (attribute.empty()) return;
+		auto compacted = std::remove_reference_t<decltype(attribute)>();
+		compacted.reserve(unique_vertices.size());
+		for (const auto &old_index : unique_vertices) { compacted.push_back(attribute[old_index]); }
+		attribute = std::move(compacted);
+	};
+	compact(geometry.positions);
+	compact(geometry.normals);
+	compact(geometry.uvs);
+	compact(geometry.tangents);
+
+	for (auto &index : geometry.indices) {
+		assert(index < vertex_count);
+		index = remap[index];
+	}
+
+	return remap;
+}
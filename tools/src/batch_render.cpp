@@ -0,0 +1,264 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h> // include glfw after glad
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <ron.h>
+
+using namespace ron;
+
+// renders the jobs of a job list without a window (see BatchRenderer) and writes every image as an
+// uncompressed 32 bit tga file.
+//
+// usage: ron_batch_render [options] <job list>
+//   --context <api>        egl: surfaceless EGL (default), osmesa: OSMesa, window: hidden window
+//   --atlas <w>x<h>        size of the render target small jobs are packed into (default: 2048x2048)
+//   --lookahead <count>    scenes imported ahead of rendering (default: 8)
+//   --cache <count>        rendered scenes kept for later jobs (default: 32)
+//   --clear-color <r>,<g>,<b>,<a>  srgb, 0 to 1 (default: 0,0,0,0)
+//   --lods                 generate lods (see gltf::ImportSettings)
+//
+// the job list has one job per line, empty lines and lines starting with # are ignored:
+//   <scene> <w>x<h> <output> [<x> <y> <z>]
+// scene is a gltf file in the asset directory, output is relative to the job list. the optional
+// view direction replaces the default one of BatchJob, the camera is always framed automatically.
+//   models/antique_camera/antique_camera.glb 256x256 thumbnails/antique_camera.tga
+//   models/antique_camera/antique_camera.glb 256x256 thumbnails/antique_camera_top.tga 0 -1 0.01
+struct Options {
+	std::string job_list = {};
+	std::string context = "egl";
+	BatchRenderer::Settings settings = {};
+	glm::vec4 clear_color = glm::vec4(0.0f);
+};
+
+static bool parse_options(const int argc, char **argv, Options &options);
+static bool parse_size(const std::string &value, glm::uvec2 &size);
+static bool read_job_list(
+	const std::string &path, std::vector<BatchJob> &jobs, std::vector<std::string> &output_paths
+);
+static bool write_tga(const std::string &path, const BatchResult &result);
+
+int main(int argc, char **argv) {
+	Options options = {};
+	if (!parse_options(argc, argv, options)) {
+		return -1;
+	}
+	std::vector<BatchJob> jobs = {};
+	std::vector<std::string> output_paths = {}; // by job id
+	if (!read_job_list(options.job_list, jobs, output_paths)) {
+		return -1;
+	}
+
+	GLFWwindow *window = create_headless_context(options.context, glm::uvec2(1), "Ron Batch Render");
+	if (window == NULL) {
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		log::error("Failed to initialize GLAD");
+		glfwTerminate();
+		return -1;
+	}
+
+	RON_PROFILE_THREAD("main");
+
+	size_t failed_count = 0;
+	const auto begin = std::chrono::steady_clock::now();
+	{ // destroy everything that holds gpu data before the OpenGL context is destroyed (glfwTerminate)
+		// the window is never shown, its size does not matter
+		auto renderer = OpenGLRenderer(1, 1);
+		renderer.set_clear_color(options.clear_color);
+		auto batch_renderer = BatchRenderer(renderer, options.settings);
+
+		for (const auto &job : jobs) {
+			batch_renderer.submit(job);
+		}
+		// results are written while later jobs import and render
+		BatchResult result = {};
+		while (batch_renderer.wait(result)) {
+			if (!write_tga(output_paths[result.id], result)) {
+				failed_count++;
+			}
+		}
+	}
+	const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	glfwTerminate();
+
+	log::success(
+		"Rendered " + std::to_string(jobs.size()) + " images in " + std::to_string(seconds) + " s ("
+		+ std::to_string(static_cast<double>(jobs.size()) / seconds) + " images/s)"
+	);
+	if (failed_count > 0) {
+		log::error("Writing " + std::to_string(failed_count) + " images failed");
+		return -1;
+	}
+	return 0;
+}
+
+bool parse_options(const int argc, char **argv, Options &options) {
+	for (int i = 1; i < argc; i++) {
+		const auto option = std::string(argv[i]);
+		if (option == "--lods") {
+			options.settings.import_settings.generate_lods = true;
+			continue;
+		}
+		else if (option.rfind("--", 0) != 0) {
+			options.job_list = option;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			log::error("Missing value for " + option);
+			return false;
+		}
+		const auto value = std::string(argv[++i]);
+		try {
+			if (option == "--context") {
+				if (value != "egl" && value != "osmesa" && value != "window") {
+					log::error("Unknown context " + value + ", expected egl, osmesa or window");
+					return false;
+				}
+				options.context = value;
+			}
+			else if (option == "--atlas") {
+				if (!parse_size(value, options.settings.atlas_size)) {
+					log::error("Invalid atlas size " + value + ", expected <width>x<height>");
+					return false;
+				}
+			}
+			else if (option == "--lookahead") {
+				options.settings.import_lookahead = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--cache") {
+				options.settings.scene_cache_size = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--clear-color") {
+				auto stream = std::istringstream(value);
+				char separator = ',';
+				stream >> options.clear_color.r >> separator >> options.clear_color.g >> separator
+					>> options.clear_color.b >> separator >> options.clear_color.a;
+				if (!stream) {
+					log::error("Invalid clear color " + value + ", expected <r>,<g>,<b>,<a>");
+					return false;
+				}
+			}
+			else {
+				log::error("Unknown option " + option);
+				return false;
+			}
+		}
+		catch (const std::exception &) {
+			log::error("Invalid value for " + option + ": " + value);
+			return false;
+		}
+	}
+	if (options.job_list.empty()) {
+		log::error("Missing job list, usage: ron_batch_render [options] <job list>");
+		return false;
+	}
+	if (options.settings.import_lookahead == 0) {
+		log::error("The lookahead must not be 0");
+		return false;
+	}
+	return true;
+}
+
+bool parse_size(const std::string &value, glm::uvec2 &size) {
+	const auto separator = value.find('x');
+	if (separator == std::string::npos) {
+		return false;
+	}
+	try {
+		size = glm::uvec2(std::stoul(value.substr(0, separator)), std::stoul(value.substr(separator + 1)));
+	}
+	catch (const std::exception &) {
+		return false;
+	}
+	return size.x > 0 && size.y > 0;
+}
+
+bool read_job_list(
+	const std::string &path, std::vector<BatchJob> &jobs, std::vector<std::string> &output_paths
+) {
+	auto file = std::ifstream(path);
+	if (!file) {
+		log::error("Failed to open the job list " + path);
+		return false;
+	}
+	const auto directory = std::filesystem::path(path).parent_path();
+
+	std::string line = {};
+	for (unsigned int line_number = 1; std::getline(file, line); line_number++) {
+		auto stream = std::istringstream(line);
+		std::string scene_path = {};
+		std::string size = {};
+		std::string output_path = {};
+		if (!(stream >> scene_path) || scene_path[0] == '#') {
+			continue;
+		}
+
+		BatchJob job = {};
+		job.id = jobs.size();
+		job.scene_path = scene_path;
+		if (!(stream >> size >> output_path) || !parse_size(size, job.size)) {
+			log::error(
+				path + ":" + std::to_string(line_number) + ": expected <scene> <w>x<h> <output> [<x> <y> <z>]"
+			);
+			return false;
+		}
+		auto view_direction = glm::vec3(0.0f);
+		if (stream >> view_direction.x >> view_direction.y >> view_direction.z) {
+			job.view_direction = view_direction;
+		}
+		jobs.push_back(job);
+		output_paths.push_back((directory / output_path).string());
+	}
+	if (jobs.empty()) {
+		log::error("The job list " + path + " contains no jobs");
+		return false;
+	}
+	return true;
+}
+
+bool write_tga(const std::string &path, const BatchResult &result) {
+	std::error_code error = {};
+	const auto directory = std::filesystem::path(path).parent_path();
+	if (!directory.empty()) {
+		std::filesystem::create_directories(directory, error);
+	}
+
+	// uncompressed true color, 8 alpha bits, rows from top to bottom
+	unsigned char header[18] = {};
+	header[2] = 2;
+	header[12] = static_cast<unsigned char>(result.size.x & 0xff);
+	header[13] = static_cast<unsigned char>(result.size.x >> 8);
+	header[14] = static_cast<unsigned char>(result.size.y & 0xff);
+	header[15] = static_cast<unsigned char>(result.size.y >> 8);
+	header[16] = 32;
+	header[17] = 0x28;
+
+	// tga stores bgra
+	auto pixels = result.data;
+	for (size_t i = 0; i < pixels.size(); i += 4) {
+		std::swap(pixels[i], pixels[i + 2]);
+	}
+
+	auto file = std::ofstream(path, std::ios::binary);
+	file.write(reinterpret_cast<const char *>(header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+	if (!file) {
+		log::error("Writing " + path + " failed");
+		return false;
+	}
+	return true;
+}